@@ -1,36 +1,191 @@
+# define _GNU_SOURCE /* pthread_getattr_np() */
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdarg.h>
 # include <string.h>
 # include <math.h>
+# include <limits.h>
 # include <time.h>
+# include <pthread.h>
+# include <sys/resource.h>
 # include "helper.h"
 
-static int return_flag = 0; // Flag to indicate a return statement
-/* Build an AST */
-struct ast *newast(int nodetype, struct ast *l, struct ast *r) {
-    struct ast *a = (struct ast *)malloc(sizeof(struct ast));
-    if (!a) {
+/* AST nodes are carved out of arenas and released all at once. The top
+   level statements of a script share the program arena, freed when the
+   script is done, and each function body gets an arena of its own, freed
+   when the function is defined again. Blocks double in size up to
+   ARENA_MAX_BLOCK, so a big script takes a few large blocks */
+#define ARENA_BLOCK 4096
+#define ARENA_MAX_BLOCK (1 << 20)
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    char data[];
+};
+
+/* the strings of the 'S' nodes of an arena, released with it */
+struct literal {
+    struct literal *next;
+    char *s;
+};
+
+/* the body and parameters of a function defined again, see arena_retire() */
+struct retired {
+    struct retired *next;
+    struct arena *body;
+    struct symlist *syms;
+};
+
+struct arena {
+    struct arena_block *blocks; /* newest first */
+    char *next, *end;           /* free room in the newest block */
+    size_t block_size;          /* size of the next block */
+    struct literal *strings;
+    struct retired *retired;    /* freed with the arena */
+    struct arena *saved;        /* arena to go back to, see arena_end() */
+};
+
+/* the program arena and the arena new nodes go to are in the context */
+static void *ast_alloc(size_t size) {
+    struct arena *ar = ctx->current;
+
+    size = (size + 15) & ~(size_t)15;
+    if ((size_t)(ar->end - ar->next) < size) {
+        size_t bsize = ar->block_size ? ar->block_size : ARENA_BLOCK;
+        while (bsize < size) bsize *= 2;
+        struct arena_block *b = malloc(sizeof(struct arena_block) + bsize);
+        if (!b) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+        b->next = ar->blocks;
+        b->size = bsize;
+        ar->blocks = b;
+        ar->next = b->data;
+        ar->end = b->data + bsize;
+        ar->block_size = bsize < ARENA_MAX_BLOCK ? bsize * 2 : bsize;
+    }
+    void *p = ar->next;
+    ar->next += size;
+    return p;
+}
+
+/* an empty arena */
+struct arena *arena_new() {
+    struct arena *ar = calloc(1, sizeof(struct arena));
+    if (!ar) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    return ar;
+}
+
+/* nodes built from now on go to a new arena */
+void arena_begin() {
+    struct arena *ar = arena_new();
+
+    ar->saved = ctx->current;
+    ctx->current = ar;
+}
+
+/* go back to the arena in use before arena_begin(), returns the new one
+   or NULL when none was begun */
+struct arena *arena_end() {
+    struct arena *ar = ctx->current;
+
+    if (ar == ctx->program) return NULL;
+    ctx->current = ar->saved;
+    return ar;
+}
+
+static void release(struct arena *ar) {
+    for (struct literal *l = ar->strings; l; l = l->next)
+        string_release(l->s);
+    ar->strings = NULL;
+
+    while (ar->retired) {
+        struct retired *r = ar->retired;
+        ar->retired = r->next;
+        arena_free(r->body);
+        symlistfree(r->syms);
+        free(r);
+    }
+
+    struct arena_block *b = ar->blocks;
+    while (b) {
+        struct arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    ar->blocks = NULL;
+    ar->next = ar->end = NULL;
+    ar->block_size = 0;
+}
+
+void arena_free(struct arena *ar) {
+    if (!ar) return;
+    release(ar);
+    free(ar);
+}
+
+/* a function defined again: the 'D' node of its first definition may be
+   walked again, by save_program() for one, so its body and parameters go
+   when the top level statements do */
+void arena_retire(struct arena *body, struct symlist *syms) {
+    struct retired *r = malloc(sizeof(struct retired));
+    if (!r) {
         yyerror("Out of memory");
         exit(1);
     }
+    r->body = body;
+    r->syms = syms;
+    r->next = ctx->program->retired;
+    ctx->program->retired = r;
+}
+
+/* free the top level statements */
+void arena_free_program() {
+    release(ctx->program);
+}
+
+/* the nodes built so far in the program arena, as an arena of their own:
+   the program arena starts again empty */
+struct arena *arena_take() {
+    struct arena *ar = malloc(sizeof(struct arena));
+    if (!ar) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    *ar = *ctx->program;
+    ar->saved = NULL;
+    memset(ctx->program, 0, sizeof(struct arena));
+    return ar;
+}
+
+/* symbol of a name token, it lives as long as the tree it appears in */
+struct symbol *newsym(char *name, size_t length) {
+    struct symbol *s = ast_alloc(sizeof(struct symbol));
+    memset(s, 0, sizeof(struct symbol));
+    s->name = intern(name, length);
+    return s;
+}
+
+/* Build an AST */
+struct ast *newast(int nodetype, struct ast *l, struct ast *r) {
+    struct ast *a = ast_alloc(sizeof(struct ast));
     a->nodetype = nodetype;
     a->l = l;
     a->r = r;
+    a->depth = -1;
+    a->slot = 0;
     return a;
 }
 
 /* Build a number AST node */
 struct ast *newnum(double d) {
-    struct ast *a = (struct ast *)malloc(sizeof(struct ast));
-    if (!a) {
-        yyerror("Out of memory");
-        exit(1);
-    }
-    a->nodetype = 'K'; // 'K' for "constant"
+    struct ast *a = newast('K', NULL, NULL); // 'K' for "constant"
     a->data.number = d;
-    a->l = NULL;
-    a->r = NULL;
     return a;
 }
 
@@ -92,93 +247,40 @@ struct ast *newflow(int nodetype, struct ast *cond, struct ast *tl, struct ast *
 
 struct ast *newfor(struct ast *init, struct ast *cond, struct ast *step, struct ast *body) {
     // Nodo che combina il corpo del ciclo con lo step
-    struct ast *body_with_step = malloc(sizeof(struct ast));
-    if (!body_with_step) {
-        yyerror("Out of space");
-        exit(1);
-    }
-    body_with_step->nodetype = 'L'; // Node of the list
-    body_with_step->l = body;      // Body of the cycle
-    body_with_step->r = step;      // Step 
+    struct ast *body_with_step = newast('L', body, step); // Body of the cycle, step
 
     // Nodo del ciclo `for`
-    struct ast *fornode = malloc(sizeof(struct ast));
-    if (!fornode) {
-        yyerror("Out of space");
-        exit(1);
-    }
-    fornode->nodetype = 'T';            // Nodo `F` per il ciclo `for`
-    fornode->l = init;                  // Inizializzazione
+    struct ast *fornode = newast('T', init, body_with_step); // Inizializzazione, corpo + step
     fornode->data.flow.cond = cond;     // Condizione
-    fornode->r = body_with_step;        // Corpo + Step
     return fornode;
 }
 
-/* build a string AST node */
-struct ast *newstr(char *s) {
-struct ast *a = malloc(sizeof(struct ast));
-    if (!a) {
-        yyerror("out of space");
-        exit(1);
-    }
-    a->nodetype = 'S'; // String node
-    a->data.s = strdup(s); // Save the string in the node   
-    
-    if (!a->data.s) {
-        yyerror("out of space for string");
-        exit(1);
-    }
+/* from parallel: a 'T' whose iterations may run on several threads, with
+   the chain of its reductions in tl, see parallel.c */
+struct ast *newparfor(struct ast *init, struct ast *cond, struct ast *step, struct ast *body, struct ast *reductions) {
+    struct ast *a = newfor(init, cond, step, body);
+
+    a->nodetype = 'P';
+    a->data.flow.tl = reductions;
+    a->data.flow.el = NULL;
     return a;
 }
 
-/* free a tree of ASTs */
-void treefree(struct ast *a)
-{
-    if (!a) return;
-    switch(a->nodetype) {
-        /* two subtrees */
-        case '+':
-        case '-':
-        case '*':
-        case '/':
-        case '^':
-        case '&':
-        case 'O':
-        case '%':
-        case '1': case '2': case '3': case '4': case '5': case '6': 
-        case 'L':
-        case '[':
-            treefree(a->r);
-        /* one subtree */
-        case '|': case 'M': case 'C': case 'F': case '!':
-            treefree(a->l);
-        /* no subtree */
-        case 'K': case 'N': case 'D':
-            break;
-        case 'S': 
-            if (a->data.sym) free(a->data.sym); 
-            break;
-        case '=':
-            treefree(a->l);
-            break;
-        /* up to three subtrees */
-        case 'I': case 'W': case 'T':
-            treefree(a->data.flow.cond);
-            if (a->data.flow.tl) treefree(a->data.flow.tl);
-            if (a->data.flow.el) treefree(a->data.flow.el);
-            break;
-        default: 
-            printf("internal error: free bad node %c\n", a->nodetype);
-    }
+/* build a string AST node */
+struct ast *newstr(char *s, size_t length) {
+    struct ast *a = newast('S', NULL, NULL); // String node
+    struct literal *l = ast_alloc(sizeof(struct literal));
 
-    free(a); /* always free the node itself */
+    a->data.s = new_string(s, length); // Shared by the values of the node
+    l->s = a->data.s;
+    l->next = ctx->current->strings;
+    ctx->current->strings = l;
+    return a;
 }
 
-/* built-in functions */
-static val_t callbuiltin(struct ast *a)
+/* built-in functions working on an already evaluated argument */
+val_t apply_builtin(enum bifs functype, val_t v)
 {
-    enum bifs functype = a->data.functype;
-    val_t v = eval(a->l);
     val_t result = {.type = 1, .data.number = 0.0}; // Default return value
 
     switch(functype) {
@@ -191,10 +293,6 @@ static val_t callbuiltin(struct ast *a)
         case B_log:
             result.data.number = log(v.data.number);
             return result;
-        case B_print:
-            struct ast *arg = a->l; // Node to initialize the argument
-            print_func(arg);
-            break;
         case B_fact:
             result.data.number = factorial(v.data.number);
             return result;
@@ -218,47 +316,6 @@ static val_t callbuiltin(struct ast *a)
                 yyerror("length() expects a list");
             }
             return result;
-        case B_get:
-            if (v.type == 3 && a->l->r) { 
-                val_t index_val = eval(a->l->r); // Evaluate the index
-                if (index_val.type == 1 || index_val.type == 6 || index_val.type == 7) { // Assume that the index is a number
-                    double index = index_val.data.number;
-                    val_t list_node = eval(a->l->l);
-                    val_t *element = get(list_node.data.list, index);
-                    if (element) {
-                        result = *element; // Element found
-                        
-                    } else {
-                        yyerror("Index out of bounds");
-                    }
-                } else {
-                    yyerror("get() expects a numeric index");
-                }
-            } else {
-                yyerror("get() expects a list and an index");
-            }
-            return result;
-        /*case B_get2D:
-        if (v.type == 3 && a->l->r && a->l->r->r) { 
-            val_t index_row = eval(a->l->r);
-            val_t index_col = eval(a->l->r->r);
-
-            if (index_row.type == 1 && index_col.type == 1) { 
-                val_t list_node = eval(a->l->l);
-                val_t *element = get2D(list_node.data.list, (int)index_row.data.number, (int)index_col.data.number);
-                if (element) {
-                    return *element; 
-                } else {
-                    yyerror("Index out of bounds");
-                }
-            } else {
-                yyerror("get2D() expects two numeric indices");
-            }
-        } else {
-            yyerror("get2D() expects a 2D list and two indices");
-        }
-        return (val_t){.type = 1, .data.number = 0.0}; // Default return
-        */
         case B_input: {
         char buffer[1024]; // Buffer for input of up to 1024 characters
 
@@ -272,7 +329,7 @@ static val_t callbuiltin(struct ast *a)
         // Read the input
         if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
             yyerror("Error reading input");
-            return (val_t){.type = 2, .data.string = strdup("")}; 
+            return (val_t){.type = 2, .data.string = new_string("", 0)}; 
         }
 
         // Remove newline character
@@ -287,7 +344,7 @@ static val_t callbuiltin(struct ast *a)
             result.data.number = num;
         } else { // else assume it's a string
             result.type = 2;
-            result.data.string = strdup(buffer);
+            result.data.string = new_string(buffer, strlen(buffer));
         }
 
         return result;
@@ -317,28 +374,139 @@ static val_t callbuiltin(struct ast *a)
     return result;
 }
 
-static val_t calluser(struct ast *a) {
-    struct symbol *fn = lookup(a->data.sym->name); /* Name of the function */
-    struct symlist *sl = fn->syms; /* Dummy arguments */
-    struct ast *args = a->l; /* Real arguments */
-    val_t v = {0}; 
-    int nargs, i;
+/* map(l, f), filter(l, f) and reduce(l, f, init): f is not evaluated,
+   it names the function */
+static val_t callapply(struct ast *a)
+{
+    struct ast *f = a->l->r->nodetype == '[' ? a->l->r->l : a->l->r;
+    val_t lst = eval(a->l->l);
+    val_t init = {.type = 1, .data.number = 0.0};
+
+    if (a->data.functype == B_reduce) init = eval(a->l->r->r);
+    return apply_function(a->data.functype, lookup_at(f->depth, f->slot, f->data.sym->name), lst, init);
+}
+
+/* built-in functions */
+static val_t callbuiltin(struct ast *a)
+{
+    enum bifs functype = a->data.functype;
+    if (functype == B_map || functype == B_filter || functype == B_reduce)
+        return callapply(a);
+
+    val_t v = eval(a->l);
+    val_t result = {.type = 1, .data.number = 0.0}; // Default return value
+
+    switch(functype) {
+        case B_print:
+            struct ast *arg = a->l; // Node to initialize the argument
+            drop_value(v);
+            print_func(arg);
+            break;
+        case B_get:
+            if (v.type == 3 && a->l->r) { 
+                val_t index_val = eval(a->l->r); // Evaluate the index
+                if (index_val.type == 1 || index_val.type == 6 || index_val.type == 7) { // Assume that the index is a number
+                    double index = index_val.data.number;
+                    val_t list_node = eval(a->l->l);
+                    val_t *element = get(list_node.data.list, index);
+                    if (element) {
+                        result = element_of_value(*element); // Also kept by the list
+                    } else {
+                        yyerror("Index out of bounds");
+                    }
+                    drop_value(list_node);
+                } else {
+                    yyerror("get() expects a numeric index");
+                    drop_value(index_val);
+                }
+            } else {
+                yyerror("get() expects a list and an index");
+            }
+            drop_value(v);
+            return result;
+        /*case B_get2D:
+        if (v.type == 3 && a->l->r && a->l->r->r) { 
+            val_t index_row = eval(a->l->r);
+            val_t index_col = eval(a->l->r->r);
+
+            if (index_row.type == 1 && index_col.type == 1) { 
+                val_t list_node = eval(a->l->l);
+                val_t *element = get2D(list_node.data.list, (int)index_row.data.number, (int)index_col.data.number);
+                if (element) {
+                    return *element; 
+                } else {
+                    yyerror("Index out of bounds");
+                }
+            } else {
+                yyerror("get2D() expects two numeric indices");
+            }
+        } else {
+            yyerror("get2D() expects a 2D list and two indices");
+        }
+        return (val_t){.type = 1, .data.number = 0.0}; // Default return
+        */
+        case B_await:
+            return await_task(v);
+        default:
+            result = apply_builtin(functype, v);
+            drop_value(v);
+            return result;
+ }
+    return result;
+}
+
+/* what a call needs from the symbol of the function: evaluating the
+   arguments may move the symbol, so it is copied first */
+struct callee {
+    struct symlist *syms; /* Dummy arguments */
+    struct ast *func;
+    char *name;
+    int nslots;
+    int nargs;
+};
+
+/* a give_back f(...) in a function leaves its call to calluser(), which
+   runs f in place of the returning function instead of nesting it. The
+   context has one, made at the first such call */
+struct tail_call {
+    int pending;
+    struct callee c;
+    val_t *vals;
+    int size;
+};
+
+/* what the tree walker keeps in a context, see synthax_ctx_free() */
+void tree_free() {
+    arena_free(ctx->program);
+    ctx->program = ctx->current = NULL;
+    if (ctx->tail) free(ctx->tail->vals);
+    free(ctx->tail);
+    ctx->tail = NULL;
+}
+
+static int find_callee(struct ast *a, struct callee *c) {
+    struct symbol *fn = lookup_at(a->depth, a->slot, a->data.sym->name); /* Name of the function */
+    struct symlist *sl;
 
     if (!fn->func) {
         yyerror("Call to undefined function: %s", fn->name);
-        return v = (val_t){.type = 1, .data.number = 0.0};
+        return 0;
     }
+    c->syms = fn->syms;
+    c->func = fn->func;
+    c->name = fn->name;
+    c->nslots = fn->nslots;
+    for (c->nargs = 0, sl = c->syms; sl; sl = sl->next)
+        c->nargs++;
+    return 1;
+}
 
-    sl = fn->syms;
-    for (nargs = 0; sl; sl = sl->next)
-        nargs++;
-
-    val_t vals[nargs];
+static int eval_args(struct ast *args, struct callee *c, val_t *vals) {
     /* Evaluate arguments */
-    for (i = 0; i < nargs; i++) {
+    for (int i = 0; i < c->nargs; i++) {
         if (!args) {
-            yyerror("Too few args in call to %s", fn->name);
-            return v = (val_t){.type = 1, .data.number = 0.0};
+            yyerror("Too few args in call to %s", c->name);
+            return 0;
         }
         if (args->nodetype == '[') { /* If it's a list node */
             vals[i] = eval(args->l);
@@ -348,13 +516,18 @@ static val_t calluser(struct ast *a) {
             args = NULL;
         }
     }
-    push_scope();
-    sl = fn->syms;
-    for (i = 0; i < nargs; i++) {
+    return 1;
+}
+
+static void bind_args(struct callee *c, val_t *vals) {
+    struct symlist *sl = c->syms;
+
+    push_scope(c->nslots);
+    for (int i = 0; i < c->nargs; i++) {
         struct symbol *s = sl->sym;
-        struct symbol *x = declare(s->name);
+        struct symbol *x = declare_at(sl->slot, s->name);
         if (vals[i].type == 2) { // String
-            x->string = strdup(vals[i].data.string);
+            x->string = vals[i].data.string; // The argument was evaluated for it
             x->type = 2;
         } else if (vals[i].type == 3) { // List
             x->list = vals[i].data.list;
@@ -364,33 +537,258 @@ static val_t calluser(struct ast *a) {
         x->value = vals[i].data.number;
         sl = sl->next;
     }
-    /* Evaluate function */
-    return_flag = 0;
-    v = eval(fn->func);
-    if (return_flag) {
-        return_flag = 0; // Reset flag 
+}
+
+/* each call of the tree walker nests eval() on the C stack, so a deep
+   recursion would overflow it: the calls stop STACK_SPARE bytes short of
+   the end of the stack of the thread they run on, whether main(), a
+   thread of --threads or of the pool, or a thread of a program using the
+   library. The vm keeps its frames on the heap and has no such limit */
+#define STACK_SPARE (256 << 10)
+
+static __thread char *stack_end;    /* lowest address the calls may reach */
+
+/* the stack of the threads synthax starts: RLIMIT_STACK, as main() has,
+   but 8 MB when it is unlimited or above 64 MB */
+size_t thread_stack_size() {
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_STACK, &rl) || rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (64 << 20))
+        return 8 << 20;
+    return rl.rlim_cur < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : rl.rlim_cur;
+}
+
+/* the main stack under ulimit -s unlimited is taken for 8 MB too */
+static char *stack_limit(char *here) {
+    pthread_attr_t attr;
+    void *addr;
+    size_t size = 0;
+
+    if (stack_end) return stack_end;
+    if (!pthread_getattr_np(pthread_self(), &attr)) {
+        if (pthread_attr_getstack(&attr, &addr, &size)) size = 0;
+        pthread_attr_destroy(&attr);
+    }
+    if (size) here = (char *)addr + size;  /* the top of the stack */
+    else size = thread_stack_size();        /* from the first call, a bit less */
+    if (size > (64 << 20)) size = 8 << 20;
+    stack_end = here - size + (size > 2 * STACK_SPARE ? STACK_SPARE : size / 2);
+    return stack_end;
+}
+
+static val_t run_call(struct callee *c, val_t *vals) {
+    int outer = ctx->frame_scope;
+    char here;
+    val_t v;
+
+    if (&here < stack_limit(&here)) {
+        yyerror("Recursion too deep in %s for the tree walker, run the script with --engine=vm", c->name);
+        for (int i = 0; i < c->nargs; i++) drop_value(vals[i]);
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+    bind_args(c, vals);
+    for (;;) {
+        /* Evaluate function */
+        ctx->frame_scope = ctx->scope_top;
+        ctx->return_flag = 0;
+        v = eval(c->func);
+        ctx->return_flag = 0; // Reset flag 
         pop_scope();
-        return v;
+        struct tail_call *tail = ctx->tail;
+        if (!tail || !tail->pending) break;
+        tail->pending = 0;
+        *c = tail->c;
+        bind_args(c, tail->vals);
     }
+    ctx->frame_scope = outer;
+    return v;
+}
 
-    pop_scope();
+static val_t calluser(struct ast *a) {
+    struct callee c;
+
+    if (!find_callee(a, &c))
+        return (val_t){.type = 1, .data.number = 0.0};
+
+    val_t vals[c.nargs];
+    if (!eval_args(a->l, &c, vals))
+        return (val_t){.type = 1, .data.number = 0.0};
+    return run_call(&c, vals);
+}
+
+/* spawn of the call a: every argument is evaluated, spawn_task() checks
+   them against the function */
+static val_t callspawn(struct ast *a) {
+    struct ast *args;
+    int n = 0;
+
+    for (args = a->l; args; args = args->nodetype == '[' ? args->r : NULL) n++;
+
+    val_t vals[n + 1];
+    n = 0;
+    for (args = a->l; args; args = args->nodetype == '[' ? args->r : NULL)
+        vals[n++] = eval(args->nodetype == '[' ? args->l : args);
+    return spawn_task(lookup_at(a->depth, a->slot, a->data.sym->name), vals, n);
+}
+
+/* call of fn by a built-in, which gives it the nargs values of args */
+val_t call_function(struct symbol *fn, val_t *args, int nargs) {
+    struct callee c = { fn->syms, fn->func, fn->name, fn->nslots, 0 };
+    struct symlist *sl;
+
+    for (sl = c.syms; sl; sl = sl->next)
+        c.nargs++;
+    if (!fn->func || nargs < c.nargs) {
+        if (!fn->func) yyerror("Call to undefined function: %s", fn->name);
+        else yyerror("Too few args in call to %s", fn->name);
+        for (int i = 0; i < nargs; i++) drop_value(args[i]);
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+    for (int i = c.nargs; i < nargs; i++) drop_value(args[i]); /* not bound to a parameter */
+    if (ctx->engine == ENGINE_VM)
+        return vm_call(fn, args);
+    return run_call(&c, args);
+}
+
+/* give_back of a call: the scopes of the function are dropped unless the
+   callee could read their variables by name */
+static val_t tailcall(struct ast *a) {
+    struct callee c;
+
+    if (!find_callee(a, &c))
+        return (val_t){.type = 1, .data.number = 0.0};
+
+    val_t vals[c.nargs];
+    if (!eval_args(a->l, &c, vals))
+        return (val_t){.type = 1, .data.number = 0.0};
+    if (scopes_seen_by_name(ctx->frame_scope))
+        return run_call(&c, vals);
+
+    struct tail_call *tail = ctx->tail;
+    if (!tail && !(tail = ctx->tail = calloc(1, sizeof(struct tail_call)))) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    if (c.nargs > tail->size) {
+        tail->size = c.nargs * 2;
+        tail->vals = realloc(tail->vals, tail->size * sizeof(val_t));
+        if (!tail->vals) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+    }
+    memcpy(tail->vals, vals, c.nargs * sizeof(val_t));
+    tail->c = c;
+    tail->pending = 1;
+    return (val_t){.type = 1, .data.number = 0.0};
+}
+
+/* '+' on evaluated operands, elems are the elements of the operand that is
+   not a list when the caller already built them */
+static val_t add_values(struct ast *a, val_t left, val_t right, struct list *elems) {
+    val_t v;
+    v.type = 1; // Default type is number
+    v.data.number = 0.0; // Default value is 0.0
+
+    if (left.type == 2 && right.type == 2) { // Strings (concatenation)
+        v.type = 2;
+        v.data.string = add_strings(left.data.string, right.data.string);
+        return v;
+    }
+    else if (left.type == 3 && right.type == 3) { // Lists (concatenation)
+        v.type = 3;
+        v.data.list = concat_lists(left.data.list, right.data.list);
+    }
+    else if (left.type == 3 && right.type != 3) { // Add element to list
+        v.type = 3;
+        struct list *new_value = elems ? elems : linked_list_ast(a->r);
+        v.data.list = concat_lists(left.data.list, new_value);  
+        if (!elems) list_release(new_value);
+    }
+    else if (left.type != 3 && right.type == 3) { // Add element to list
+        v.type = 3;
+        struct list *new_value = elems ? elems : linked_list_ast(a->l);
+        v.data.list = concat_lists(new_value, right.data.list);  
+        if (!elems) list_release(new_value);
+    }
+    else if (left.type != right.type) {
+        yyerror("Type mismatch in '+' operation");
+    }
+    else { // Numbers
+        v.type = 1;
+        v.data.number = left.data.number + right.data.number;
+    } 
+    drop_value(left);
+    drop_value(right);
     return v;
 }
 
+/* is n a reference to the variable assigned by a? */
+int same_variable(struct ast *a, struct ast *n) {
+    return n && n->nodetype == 'N' && a->data.sym->name == n->data.sym->name;
+}
+
+/* x = x + e or x = e + x: a list that only x holds gets the elements of e
+   added in place, as does a string only x holds for x = x + e, and 1 is
+   returned. Otherwise val is the value of the sum */
+static int assign_add(struct ast *a, val_t *val) {
+    struct ast *sum = a->l;
+    int front = !same_variable(a, sum->l);
+    struct ast *other = front ? sum->l : sum->r;
+    val_t left = eval(sum->l);
+    val_t right = eval(sum->r);
+    val_t x = front ? right : left;
+    val_t e = front ? left : right;
+    struct list *elems = NULL;
+
+    if (x.type == 3) {
+        /* '+' evaluates the element again, unless that cannot be seen */
+        if (e.type != 3 && other->nodetype != 'K' && other->nodetype != 'S' && other->nodetype != 'N')
+            elems = linked_list_ast(other);
+        /* only for variables bound by the resolver: a variable of a caller
+           could also be an operand the caller is still evaluating */
+        struct symbol *sym = slot_at(a->depth, a->slot);
+        if (sym && list_add_in_place(sym, x.data.list, e, elems, front)) {
+            drop_value(x);
+            drop_value(e); // The list keeps its own copy
+            list_release(elems);
+            return 1;
+        }
+    } else if (x.type == 2 && e.type == 2 && !front) {
+        /* any variable: the references tell that no one else sees the string */
+        struct symbol *sym = lookup_at(a->depth, a->slot, a->data.sym->name);
+        if (string_add_in_place(sym, x.data.string, e.data.string)) {
+            drop_value(e);
+            return 1;
+        }
+    }
+    *val = add_values(sum, left, right, elems);
+    list_release(elems);
+    return 0;
+}
+
+/* is the condition of a loop true */
+static int test(struct ast *cond) {
+    val_t v = eval(cond);
+    int holds = v.data.number != 0;
+
+    drop_value(v);
+    return holds;
+}
+
 /* evaluate an AST */
 val_t eval(struct ast *a)
 {   
     val_t v;
     v.type = 1; // Default type is number
     v.data.number = 0.0; // Default value is 0.0
-    v.data.string = strdup(""); // Default string value is empty
 
     if(!a) {
     yyerror("internal error, null eval");
     return v;
     exit(1);
     }
-    if(return_flag) {
+    if(ctx->return_flag) {
         return v;
     }
 
@@ -403,18 +801,20 @@ val_t eval(struct ast *a)
         /* string */
         case 'S': 
             v.type = 2; // String
-            v.data.string = strdup(a->data.s);
+            v.data.string = a->data.s;
+            string_retain(v.data.string);
             break;
         /* name reference */
         case 'N': 
-            struct symbol *sym = lookup(a->data.sym->name);
+            struct symbol *sym = lookup_at(a->depth, a->slot, a->data.sym->name);
             if (sym->type == 2) { //string
                 v.type = 2;
-                v.data.string = strdup(sym->string);
+                v.data.string = symbol_string(sym);
             } 
             else if(sym->type == 3) { //list
                 v.type = 3;
                 v.data.list = sym->list;
+                list_retain(v.data.list);
             }
             else {
                 v.type = 1; // Number
@@ -423,21 +823,22 @@ val_t eval(struct ast *a)
             break;
         /* declaration */
         case 'D':
-            struct symbol *s = declare(a->data.sym->name);
-            *s = *(a->data.sym); // Copy the symbol
+            declare_symbol(a->slot, a->data.sym); // Copy the symbol
             break;
         /* retrun */
         case 'R':
           
-        if (a->l){
+        if (a->l && a->l->nodetype == 'C' && ctx->frame_scope > 0) {
+        v = tailcall(a->l);
+        } else if (a->l){
         v = eval(a->l);
         }
-        return_flag = 1;
+        ctx->return_flag = 1;
         return v; 
         /* assignment */
         case '=': 
             {
-            struct symbol *sym = lookup(a->data.sym->name); // Symbol being assigned
+            struct symbol *sym = lookup_at(a->depth, a->slot, a->data.sym->name); // Symbol being assigned
 
             if (a->l == NULL) {
                 
@@ -447,9 +848,11 @@ val_t eval(struct ast *a)
                     v.type = 1;
                 } else if (sym->type == 2) {
                     sym->value = 0.0; // Default "dummy" value for strings (or handle differently)
-                    sym->string = strdup("");   // Or set to a valid default string value
+                    string_release(sym->string);
+                    sym->string = new_string("", 0);   // Or set to a valid default string value
                     v.type = sym->type;
                 } else if (sym->type == 3) { // Default list initialization
+                    list_release(sym->list);
                     sym->list = NULL; // Empty list
                     v.type = sym->type;
                     v.data.list = NULL;
@@ -461,7 +864,13 @@ val_t eval(struct ast *a)
                 break;
             }
             
-            val_t val = eval(a->l);         // Evaluate the expression on the left-hand side
+            val_t val;
+            if (a->l->nodetype == '+' && (same_variable(a, a->l->l) || same_variable(a, a->l->r))) {
+                if (assign_add(a, &val)) break; // The variable grew in place
+            } else {
+                val = eval(a->l);         // Evaluate the expression on the left-hand side
+            }
+            sym = lookup_at(a->depth, a->slot, a->data.sym->name); // The scopes may have grown meanwhile
             /* Treat numeric data-types equally*/
             if ((sym->type == 6 || sym->type == 7) && val.type == 1) {
                 val.type = sym->type;
@@ -470,10 +879,11 @@ val_t eval(struct ast *a)
             if (sym->type != val.type && sym->type != 3) {
                 yyerror("Type mismatch: cannot assign type %d to variable '%s' of type %d",
                         val.type, sym->name, sym->type);
+                drop_value(val);
                 if (sym->type == 1 || sym->type == 6 || sym->type == 7) {  /* Numeric type*/
                     return v = (val_t){.type = 1, .data.number = sym->value};
                 } else if (sym->type == 2) { /* String type*/
-                    return v = (val_t){.type = 2, .data.string = strdup(sym->string)};
+                    return v = (val_t){.type = 2, .data.string = symbol_string(sym)};
                 } else if (sym->type == 3) { /* List type*/
                     return v = (val_t){.type = 3, .data.list = sym->list};
                 }
@@ -486,20 +896,24 @@ val_t eval(struct ast *a)
                 v.data.number = sym->value;
             }
             else if (sym->type == 2) {
-                free(sym->string); // Free the old string value
-                sym->string = strdup(val.data.string); // Assign the new string value
+                string_release(sym->string); // Give back the old string value
+                sym->string = val.data.string; // Keep the new string value
                 v.type = sym->type;
-                v.data.string = strdup(sym->string);
+                v.data.string = sym->string;
+                string_retain(v.data.string);
             }
             else if (sym->type == 3) {
+                list_release(sym->list);
                 if (val.type == 3 && val.data.list) { //list already declared
                     sym->list = val.data.list; 
                 }
                 else {
+                drop_value(val); // The elements are evaluated again
                 struct list *lst = linked_list_ast(a->l); // Create a list from the AST
                 sym->list = lst; 
                 v.type = sym->type;
                 v.data.list = sym->list;
+                list_retain(v.data.list);
                 }
                 } 
             break;
@@ -509,35 +923,7 @@ val_t eval(struct ast *a)
         case '+': {
             val_t left = eval(a->l);
             val_t right = eval(a->r);
-            
-            if (left.type == 2 && right.type == 2) { // Strings (concatenation)
-                size_t len = strlen(left.data.string) + strlen(right.data.string) + 1;
-                v.type = 2;
-                v.data.string = malloc(len);
-                snprintf(v.data.string, len, "%s%s", left.data.string, right.data.string);
-            }
-            else if (left.type == 3 && right.type == 3) { // Lists (concatenation)
-                v.type = 3;
-                v.data.list = concat_lists(left.data.list, right.data.list);
-            }
-            else if (left.type == 3 && right.type != 3) { // Add element to list
-            v.type = 3;
-            struct list *new_value = linked_list_ast(a->r);
-            v.data.list = concat_lists(left.data.list, new_value);  
-            }
-            else if (left.type != 3 && right.type == 3) { // Add element to list
-            v.type = 3;
-            struct list *new_value = linked_list_ast(a->l);
-            v.data.list = concat_lists(new_value, right.data.list);  
-            }
-            else if (left.type != right.type) {
-                yyerror("Type mismatch in '+' operation");
-                return v;
-            }
-            else { // Numbers
-                v.type = 1;
-                v.data.number = left.data.number + right.data.number;
-            } 
+            v = add_values(a, left, right, NULL);
             break;
         }
         case '-': 
@@ -550,6 +936,8 @@ val_t eval(struct ast *a)
 
             if (left.type != right.type) {
                 yyerror("Type mismatch operation");
+                drop_value(left);
+                drop_value(right);
                 return v;
             }
             if (left.type == 2|| right.type == 2) {
@@ -565,6 +953,8 @@ val_t eval(struct ast *a)
                 case '%': v.data.number = fmod(left.data.number, right.data.number); break;
                 case '^': v.data.number = pow(left.data.number, right.data.number); break;
             }
+            drop_value(left); /* lists */
+            drop_value(right);
             break;
         }
         case '|': {
@@ -574,7 +964,11 @@ val_t eval(struct ast *a)
                 exit(1);
             }
             v.type = 1;
-            v.data.number = fabs(eval(a->l).data.number); break;
+            drop_value(left);
+            left = eval(a->l);
+            v.data.number = fabs(left.data.number);
+            drop_value(left);
+            break;
         }
 
         case 'M': {
@@ -584,14 +978,21 @@ val_t eval(struct ast *a)
                 exit(1);
             }
             v.type = 1;
-            v.data.number = -eval(a->l).data.number; break;
+            drop_value(left);
+            left = eval(a->l);
+            v.data.number = -left.data.number;
+            drop_value(left);
+            break;
         }
         case '!': {
             if(!a->l) {
                 yyerror("Invalid operand to 'not' operator");
                 exit(1);
             }
-            v.data.number = !(eval(a->l).data.number); break;
+            val_t operand = eval(a->l);
+            v.data.number = !operand.data.number;
+            drop_value(operand);
+            break;
         }
         /* comparisons */
         case '1': // Greater than
@@ -608,6 +1009,8 @@ val_t eval(struct ast *a)
 
             if (left.type != right.type) {
                 yyerror("Type mismatch for comparison");
+                drop_value(left);
+                drop_value(right);
                 return v;
             }
 
@@ -618,7 +1021,7 @@ val_t eval(struct ast *a)
                 case '3': v.data.number = (left.data.number != right.data.number) ? 1 : 0; break;
                 case '4': 
                             if (left.type == 2 && right.type == 2) { 
-                                v.data.number = (strcasecmp (left.data.string, right.data.string) == 0) ? 1 : 0; 
+                                v.data.number = string_equal(left.data.string, right.data.string); 
                             } else { 
                                 v.data.number = (left.data.number == right.data.number) ? 1 : 0; 
                             } 
@@ -628,6 +1031,8 @@ val_t eval(struct ast *a)
                 case 'O': v.data.number = (left.data.number || right.data.number) ? 1 : 0; break;
                 case '&': v.data.number = (left.data.number && right.data.number) ? 1 : 0; break;
             }
+            drop_value(left);
+            drop_value(right);
             break;
         }
         
@@ -636,6 +1041,7 @@ val_t eval(struct ast *a)
         /* if/then/else */
         case 'I':
             val_t cond_val = eval(a->data.flow.cond);
+            drop_value(cond_val);
             if (cond_val.data.number != 0) { 
                 v = a->data.flow.tl ? eval(a->data.flow.tl) : (val_t){.type = 1, .data.number = 0.0};
             } else {
@@ -644,20 +1050,22 @@ val_t eval(struct ast *a)
             break;
         /* while/do */
         case 'W':
-        push_scope(); // Push a new scope
+        push_scope(a->slot); // Push a new scope
         v.data.number = 0; /* a default value */
         if (a->data.flow.tl && a->data.flow.el) {
             do {
+                drop_value(v);
                 v = eval(a->data.flow.tl);
-                if (return_flag){ 
+                if (ctx->return_flag){ 
                     break;
                 } 
-            } while (eval(a->data.flow.cond).data.number != 0);
+            } while (test(a->data.flow.cond));
         }
         if(a->data.flow.tl ) {
-            while( eval(a->data.flow.cond).data.number != 0) {
+            while(test(a->data.flow.cond)) {
+                drop_value(v);
                 v = eval(a->data.flow.tl); 
-                 if (return_flag){ 
+                 if (ctx->return_flag){ 
                     break;
                 }
             }
@@ -666,18 +1074,23 @@ val_t eval(struct ast *a)
         pop_scope(); // Pop the scope
         break; /* value of last statement is value of while/do */
 
-        /* for loop */
+        /* for loop, on threads when it can, see parallel.c */
+        case 'P':
+        if (parallel_for(a, &v)) break;
+        /* fall through */
         case 'T':
-        push_scope(); // Push a new scope 
-        eval(a->l); // Initialize
-            while (eval(a->data.flow.cond).data.number != 0) { // Control the condition
+        push_scope(a->slot); // Push a new scope 
+        drop_value(eval(a->l)); // Initialize
+            while (test(a->data.flow.cond)) { // Control the condition
+                drop_value(v);
                 v = eval(a->r->l);
-                if (return_flag){ 
+                if (ctx->return_flag){ 
                     break;
                 }
                  // Execute the body
+                drop_value(v);
                 v = eval(a->r->r); // Execute the step
-                if (return_flag){                
+                if (ctx->return_flag){                
                     break;
                 }
                
@@ -701,9 +1114,12 @@ val_t eval(struct ast *a)
                  val_t right_val = eval(a->r);
                  // If both elements are lists, concatenate them
                  if (left_val.type == 3 && right_val.type == 3) {
+                     list_release(v.data.list);
                      v.data.list = concat_lists(left_val.data.list, right_val.data.list);
                  }
+                 drop_value(right_val);
              }
+             if (left_val.type == 3) drop_value(left_val);
          }
          break;
         /* list of statements */
@@ -712,13 +1128,15 @@ val_t eval(struct ast *a)
             val_t left_val = eval(a->l);
             v = left_val;
         }
-        if(a->r && !return_flag) {
+        if(a->r && !ctx->return_flag) {
             val_t right_val = eval(a->r);
+            drop_value(v);
             v = right_val;
         }
         break;
         case 'F': v = callbuiltin(a); break;
         case 'C':  v = calluser(a);  break;
+        case 'A':  v = callspawn(a->l);  break;
         default: printf("internal error: bad node %c\n", a->nodetype);
     }
     return v;
@@ -728,9 +1146,10 @@ val_t eval(struct ast *a)
 void dodef(struct symbol *name, struct symlist *syms, struct ast *func)
 {
  if(name->syms) symlistfree(name->syms);
- if(name->func) treefree(name->func);
  name->syms = syms;
  name->func = func;
+ name->arena = arena_end();
+ name->nslots = resolve_function(syms, func);
  name->type = 3; 
 }
 
@@ -738,12 +1157,13 @@ void dodef(struct symbol *name, struct symlist *syms, struct ast *func)
 void yyerror(const char *s, ...) {
     va_list ap;
     va_start(ap, s);
-    fprintf(stderr, "%d: Error: ", yylineno);
+    fprintf(stderr, "%d: Error: ", yyget_lineno(ctx->scanner));
     vfprintf(stderr, s, ap);
     fprintf(stderr, "\n");
     va_end(ap);
-        if (feof(yyin)) {
+        if (input_read_whole(ctx->scanner)) {
         fprintf(stderr, "Parsing stopped due to errors in file.\n");
+        if (ctx->stop) longjmp(*ctx->stop, 1); /* only this script stops */
         exit(1);
     }
 }
@@ -783,9 +1203,6 @@ void optimize_ast(struct ast *node) {
             
             node->nodetype = 'K';
             node->data.number = result.data.number;
-
-            free(node->l);
-            free(node->r);
             node->l = node->r = NULL;
         }
     }
@@ -828,6 +1245,8 @@ void print_ast(struct ast *node, int depth, char *prefix) {
         case 'F': printf(", Built-in Function: %d\n", node->data.functype); break;
         /* User-defined function*/
         case 'C': printf(", User Function: %s\n", node->data.sym->name);break;
+        /* spawn of the call below */
+        case 'A': printf(" (Spawn)\n"); break;
         /* String literal */
         case 'S': printf(", String: %s\n", node->data.s);break;
         /* Return */
@@ -838,6 +1257,7 @@ void print_ast(struct ast *node, int depth, char *prefix) {
         case 'W': printf(" (While Loop)\n"); break;
         /*For loop*/
         case 'T':   printf(" (For Loop)\n");break;
+        case 'P':   printf(" (Parallel For Loop)\n");break;
         default: printf("\n"); break;
     }
 
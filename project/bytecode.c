@@ -0,0 +1,343 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include "helper.h"
+
+/* Lower an AST into the linear bytecode run by vm.c.
+   Every construct keeps the semantics of eval(), including the value of
+   the last statement being the result of a function without give_back. */
+
+static void compile_stmt(struct bytecode *bc, struct ast *a);
+static void compile_expr(struct bytecode *bc, struct ast *a);
+
+static int emit(struct bytecode *bc, int op, int arg) {
+    if (bc->len == bc->size) {
+        bc->size = bc->size ? bc->size * 2 : 64;
+        bc->code = realloc(bc->code, bc->size * sizeof(struct instr));
+        if (!bc->code) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+    }
+    struct instr *i = &bc->code[bc->len];
+    i->op = op;
+    i->arg = arg;
+    i->depth = -1;
+    i->slot = 0;
+    i->k.number = 0;
+    return bc->len++;
+}
+
+static void emit_num(struct bytecode *bc, double d) {
+    int pc = emit(bc, OP_NUM, 0);
+    bc->code[pc].k.number = d;
+}
+
+static void emit_str(struct bytecode *bc, char *s) {
+    int pc = emit(bc, OP_STR, 0);
+    bc->code[pc].k.s = s;
+}
+
+/* instruction on the variable of a resolved node */
+static void emit_sym(struct bytecode *bc, int op, int arg, struct ast *a) {
+    int pc = emit(bc, op, arg);
+    bc->code[pc].k.sym = a->data.sym;
+    bc->code[pc].depth = a->depth;
+    bc->code[pc].slot = a->slot;
+}
+
+/* point the jump emitted at pc to the next instruction */
+static void patch(struct bytecode *bc, int pc) {
+    bc->code[pc].arg = bc->len;
+}
+
+/* push every element of a '[' chain, return how many there are */
+static int compile_elements(struct bytecode *bc, struct ast *a) {
+    int n = 0;
+    while (a) {
+        if (a->nodetype == '[') {
+            compile_expr(bc, a->l);
+            a = a->r;
+        } else {
+            compile_expr(bc, a);
+            a = NULL;
+        }
+        n++;
+    }
+    return n;
+}
+
+/* operand of '+' or of a list assignment: list literals keep their elements */
+static int compile_operand(struct bytecode *bc, struct ast *a) {
+    if (a && a->nodetype == '[') {
+        emit(bc, OP_LISTLIT, compile_elements(bc, a));
+        return 1;
+    }
+    compile_expr(bc, a);
+    return 0;
+}
+
+/* constants, names and lists of them can be evaluated twice or not at all
+   without any visible difference */
+static int is_simple(struct ast *a) {
+    if (!a) return 0;
+    switch (a->nodetype) {
+        case 'K': case 'S': case 'N': return 1;
+        case '[': return is_simple(a->l) && is_simple(a->r);
+        default: return 0;
+    }
+}
+
+/* eval() runs some operands twice, repeat that only when it can be seen */
+static void compile_discard(struct bytecode *bc, struct ast *a) {
+    if (is_simple(a)) return;
+    compile_expr(bc, a);
+    emit(bc, OP_POP, 0);
+}
+
+/* built-in call, the arguments are taken apart like callbuiltin() does */
+static void compile_builtin(struct bytecode *bc, struct ast *a) {
+    struct ast *cur;
+
+    switch (a->data.functype) {
+        case B_print:
+            compile_discard(bc, a->l);
+            for (cur = a->l; cur; cur = cur->nodetype == '[' ? cur->r : NULL) {
+                compile_expr(bc, cur->nodetype == '[' ? cur->l : cur);
+                emit(bc, OP_PRINT, cur->nodetype == '[');
+            }
+            emit_num(bc, 0);
+            break;
+        case B_get:
+            if (a->l && a->l->nodetype == '[') {
+                compile_discard(bc, a->l);
+                compile_expr(bc, a->l->r);
+                compile_expr(bc, a->l->l);
+                emit(bc, OP_GET, 0);
+            } else { /* no index given */
+                emit_num(bc, 0);
+                compile_expr(bc, a->l);
+                emit(bc, OP_GET, 1);
+            }
+            break;
+        case B_map: case B_filter: case B_reduce: /* the function is not evaluated */
+            compile_expr(bc, a->l->l);
+            if (a->data.functype == B_reduce) {
+                compile_expr(bc, a->l->r->r);
+                emit_sym(bc, OP_APPLY, B_reduce, a->l->r->l);
+            } else {
+                emit_sym(bc, OP_APPLY, a->data.functype, a->l->r);
+            }
+            break;
+        case B_await:
+            compile_expr(bc, a->l);
+            emit(bc, OP_AWAIT, 0);
+            break;
+        default:
+            compile_expr(bc, a->l);
+            emit(bc, OP_BUILTIN, a->data.functype);
+    }
+}
+
+static void compile_expr(struct bytecode *bc, struct ast *a) {
+    if (!a) {
+        emit(bc, OP_NULL, 0);
+        return;
+    }
+
+    switch (a->nodetype) {
+        case 'K': emit_num(bc, a->data.number); break;
+        case 'S': emit_str(bc, a->data.s); break;
+        case 'N': emit_sym(bc, OP_LOAD, 0, a); break;
+        case '=':
+            if (!a->l) {
+                emit_sym(bc, OP_STORE_INIT, 0, a);
+                break;
+            }
+            if (a->l->nodetype == '+' && (same_variable(a, a->l->l) || same_variable(a, a->l->r))) {
+                int flags = compile_operand(bc, a->l->l);
+                flags |= compile_operand(bc, a->l->r) << 1;
+                if (!same_variable(a, a->l->l)) flags |= 4;
+                emit_sym(bc, OP_STORE_ADD, flags, a);
+                break;
+            }
+            emit_sym(bc, OP_STORE, compile_operand(bc, a->l), a);
+            break;
+        case '+': {
+            int flags = compile_operand(bc, a->l);
+            flags |= compile_operand(bc, a->r) << 1;
+            emit(bc, OP_ADD, flags);
+            break;
+        }
+        case '-': case '*': case '/': case '^': case '%':
+            compile_expr(bc, a->l);
+            compile_expr(bc, a->r);
+            emit(bc, a->nodetype == '-' ? OP_SUB :
+                     a->nodetype == '*' ? OP_MUL :
+                     a->nodetype == '/' ? OP_DIV :
+                     a->nodetype == '^' ? OP_POW : OP_MOD, 0);
+            break;
+        case '|': case 'M':
+            if (!is_simple(a->l)) { /* checked on a first evaluation */
+                compile_expr(bc, a->l);
+                emit(bc, a->nodetype == '|' ? OP_ABS : OP_NEG, 0);
+                emit(bc, OP_POP, 0);
+            }
+            compile_expr(bc, a->l);
+            emit(bc, a->nodetype == '|' ? OP_ABS : OP_NEG, 0);
+            break;
+        case '!': compile_expr(bc, a->l); emit(bc, OP_NOT, 0); break;
+        case '1': case '2': case '3': case '4': case '5': case '6':
+        case 'O': case '&':
+            compile_expr(bc, a->l);
+            compile_expr(bc, a->r);
+            emit(bc, OP_CMP, a->nodetype);
+            break;
+        case '[': emit(bc, OP_CHAIN, compile_elements(bc, a)); break;
+        case 'F': compile_builtin(bc, a); break;
+        case 'C': {
+            int nargs = compile_elements(bc, a->l);
+            emit_sym(bc, OP_CALL, nargs, a);
+            break;
+        }
+        case 'A': {
+            int nargs = compile_elements(bc, a->l->l);
+            emit_sym(bc, OP_SPAWN, nargs, a->l);
+            break;
+        }
+        /* statements used as values */
+        case 'L': case 'D': case 'I': case 'W': case 'T': case 'P': case 'R':
+            compile_stmt(bc, a);
+            emit(bc, OP_PUSHLAST, 0);
+            break;
+        default:
+            printf("internal error: bad node %c\n", a->nodetype);
+            emit_num(bc, 0);
+    }
+}
+
+static void compile_stmt(struct bytecode *bc, struct ast *a) {
+    int jmp, top, par = -1;
+
+    if (!a) {
+        emit(bc, OP_NULL, 0);
+        emit(bc, OP_SETLAST, 0);
+        return;
+    }
+
+    switch (a->nodetype) {
+        case 'L':
+            if (a->l) compile_stmt(bc, a->l);
+            if (a->r) compile_stmt(bc, a->r);
+            break;
+        case 'D':
+            emit_sym(bc, OP_DECLARE, 0, a);
+            emit_num(bc, 0);
+            emit(bc, OP_SETLAST, 0);
+            break;
+        case 'R':
+            if (a->l && a->l->nodetype == 'C') { /* give_back f(...) */
+                int nargs = compile_elements(bc, a->l->l);
+                emit_sym(bc, OP_TAILCALL, nargs, a->l);
+            } else if (a->l) {
+                compile_expr(bc, a->l);
+            } else {
+                emit_num(bc, 0); /* give_back without a value */
+            }
+            emit(bc, OP_RET, 0);
+            break;
+        case 'I': {
+            compile_expr(bc, a->data.flow.cond);
+            int jz = emit(bc, OP_JZ, 0);
+            if (a->data.flow.tl) {
+                compile_stmt(bc, a->data.flow.tl);
+            } else {
+                emit_num(bc, 0);
+                emit(bc, OP_SETLAST, 0);
+            }
+            jmp = emit(bc, OP_JMP, 0);
+            patch(bc, jz);
+            if (a->data.flow.el) {
+                compile_stmt(bc, a->data.flow.el);
+            } else {
+                emit_num(bc, 0);
+                emit(bc, OP_SETLAST, 0);
+            }
+            patch(bc, jmp);
+            break;
+        }
+        case 'W':
+            emit(bc, OP_SCOPE, a->slot);
+            emit_num(bc, 0);
+            emit(bc, OP_SETLAST, 0);
+            if (a->data.flow.tl && a->data.flow.el) { /* when {} until [] */
+                top = bc->len;
+                compile_stmt(bc, a->data.flow.tl);
+                compile_expr(bc, a->data.flow.cond);
+                emit(bc, OP_JNZ, top);
+            }
+            if (a->data.flow.tl) {
+                top = bc->len;
+                compile_expr(bc, a->data.flow.cond);
+                jmp = emit(bc, OP_JZ, 0);
+                compile_stmt(bc, a->data.flow.tl);
+                emit(bc, OP_JMP, top);
+                patch(bc, jmp);
+            }
+            emit(bc, OP_UNSCOPE, 0);
+            break;
+        case 'P': /* the 'T' code runs when the threads cannot, see parallel.c */
+            par = emit(bc, OP_PARFOR, 0);
+            bc->code[par].k.loop = a;
+            /* fall through */
+        case 'T':
+            emit(bc, OP_SCOPE, a->slot);
+            compile_stmt(bc, a->l);
+            emit_num(bc, 0);
+            emit(bc, OP_SETLAST, 0);
+            top = bc->len;
+            compile_expr(bc, a->data.flow.cond);
+            jmp = emit(bc, OP_JZ, 0);
+            compile_stmt(bc, a->r->l);
+            compile_stmt(bc, a->r->r);
+            emit(bc, OP_JMP, top);
+            patch(bc, jmp);
+            emit(bc, OP_UNSCOPE, 0);
+            if (par >= 0) patch(bc, par);
+            break;
+        default:
+            compile_expr(bc, a);
+            emit(bc, OP_SETLAST, 0);
+    }
+}
+
+static struct bytecode *new_bytecode() {
+    struct bytecode *bc = calloc(1, sizeof(struct bytecode));
+    if (!bc) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    return bc;
+}
+
+/* compile a top level statement list */
+struct bytecode *compile_unit(struct ast *a) {
+    struct bytecode *bc = new_bytecode();
+    compile_stmt(bc, a);
+    emit(bc, OP_HALT, 0);
+    return bc;
+}
+
+/* compile the body of a user function */
+struct bytecode *compile_function(struct symbol *fn) {
+    struct bytecode *bc = new_bytecode();
+    compile_stmt(bc, fn->func);
+    emit(bc, OP_RETLAST, 0);
+    return bc;
+}
+
+void free_bytecode(struct bytecode *bc) {
+    if (!bc) return;
+    free(bc->code);
+    free(bc);
+}
@@ -0,0 +1,517 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <stdint.h>
+# include <unistd.h>
+# include <fcntl.h>
+# include <errno.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "helper.h"
+
+/* Cache of parsed scripts, synthax --cache. The tree a script leaves
+   after parsing and optimize_ast() is saved to <dir>/<digest>.syc, named
+   after the SHA-256 digest of the text of the script. Running the same
+   text again maps that file and builds the tree from it, with no
+   scanning or parsing. Only the resolver runs again on the tree built:
+   the slots it hands out belong to the context.
+
+   The header has the whole digest and the build of synthax that wrote
+   the file, a file of another text or of another build is not read.
+
+   The file is a header and then records, each making one object of the
+   tree, a node or a symbol, after the objects it refers to. An object is
+   referred to by its number in the order of the records, -1 for none.
+   The numbers are written as they are in memory: the cache belongs to
+   the machine that wrote it. */
+
+/* the build the records are of: make passes a checksum of this file and
+   of helper.h, which have the records and the nodes, see the Makefile.
+   Built otherwise, the time of the build */
+#ifndef CACHE_BUILD
+#define CACHE_BUILD __DATE__ " " __TIME__
+#endif
+
+#define DIGEST 32   /* bytes of a SHA-256 digest */
+
+struct cache_header {
+    char magic[4];
+    char build[32];                 /* CACHE_BUILD, cut to fit */
+    unsigned char digest[DIGEST];   /* of the text of the script */
+    uint64_t length;                /* of the text of the script */
+    int32_t count;                  /* number of records */
+    int32_t root;                   /* the top level statements */
+};
+
+enum record {
+    R_NODE,         /* nodetype l r, then the data of the nodetype */
+    R_SYMBOL,       /* type, name */
+    R_BODY,         /* the records up to R_FUNCTION are the body of a function */
+    R_FUNCTION,     /* type, name, number of parameters, parameters, body */
+};
+
+/* SHA-256, FIPS 180-4 */
+static const uint32_t sha_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+static void sha_block(uint32_t *h, const unsigned char *p) {
+    uint32_t w[64], a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ w[i - 15] >> 3;
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ w[i - 2] >> 10;
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + sha_k[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void digest_text(const char *text, size_t length, unsigned char *digest) {
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    unsigned char last[128] = { 0 };
+    size_t done = length & ~(size_t)63, rest = length - done, n = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)length * 8;
+
+    for (size_t i = 0; i < done; i += 64) sha_block(h, (const unsigned char *)text + i);
+    memcpy(last, text + done, rest);
+    last[rest] = 0x80;
+    for (int i = 0; i < 8; i++) last[n - 1 - i] = bits >> (8 * i);
+    for (size_t i = 0; i < n; i += 64) sha_block(h, last + i);
+    for (int i = 0; i < 32; i++) digest[i] = h[i / 4] >> (24 - 8 * (i % 4));
+}
+
+/* Writing: each object is written once, the objects of the tree already
+   written are in a table of their pointers */
+struct writer {
+    FILE *f;
+    void **objects;
+    int *numbers;
+    int size;
+    int count;              /* records written */
+    const char *tmp;        /* the file being written, removed when it fails */
+};
+
+/* out of memory while writing: the file is not left half written */
+static void out_of_memory(struct writer *w) {
+    unlink(w->tmp);
+    yyerror("Out of memory");
+    exit(1);
+}
+
+static int *number_of(struct writer *w, void *p) {
+    size_t i = ((uintptr_t)p >> 4) & (w->size - 1);
+
+    while (w->objects[i] && w->objects[i] != p) i = (i + 1) & (w->size - 1);
+    if (!w->objects[i]) {
+        w->objects[i] = p;
+        w->numbers[i] = -1;
+    }
+    return &w->numbers[i];
+}
+
+/* the number the record about to be written gets, the table is kept at
+   most half full */
+static int add_object(struct writer *w, int *number) {
+    *number = w->count++;
+    if (2 * w->count > w->size) {
+        void **objects = w->objects;
+        int *numbers = w->numbers, size = w->size;
+
+        w->size *= 2;
+        w->objects = calloc(w->size, sizeof(void *));
+        w->numbers = malloc(w->size * sizeof(int));
+        if (!w->objects || !w->numbers) out_of_memory(w);
+        for (int i = 0; i < size; i++) {
+            if (objects[i]) *number_of(w, objects[i]) = numbers[i];
+        }
+        free(objects);
+        free(numbers);
+    }
+    return w->count - 1;
+}
+
+static void put_int(struct writer *w, int32_t v) {
+    fwrite(&v, sizeof(v), 1, w->f);
+}
+
+static void put_bytes(struct writer *w, const char *s, size_t length) {
+    put_int(w, length);
+    fwrite(s, 1, length, w->f);
+}
+
+static int put_node(struct writer *w, struct ast *a);
+
+static int put_symbol(struct writer *w, struct symbol *s) {
+    int *number, body, nparams = 0;
+    struct symlist *sl;
+
+    number = number_of(w, s);
+    if (*number >= 0) return *number;
+    if (!s->func) {
+        put_int(w, R_SYMBOL);
+        put_int(w, s->type);
+        put_bytes(w, s->name, strlen(s->name));
+        return add_object(w, number);
+    }
+    put_int(w, R_BODY);
+    for (sl = s->syms; sl; sl = sl->next, nparams++) put_symbol(w, sl->sym);
+    body = put_node(w, s->func);
+    put_int(w, R_FUNCTION);
+    put_int(w, s->type);
+    put_bytes(w, s->name, strlen(s->name));
+    put_int(w, nparams);
+    for (sl = s->syms; sl; sl = sl->next) put_int(w, *number_of(w, sl->sym));
+    put_int(w, body);
+    return add_object(w, number_of(w, s)); /* the table may have grown */
+}
+
+static int put_node(struct writer *w, struct ast *a) {
+    int *number, l, r, sym = -1, cond = -1, tl = -1, el = -1;
+
+    if (!a) return -1;
+    number = number_of(w, a);
+    if (*number >= 0) return *number;
+    l = put_node(w, a->l);
+    r = put_node(w, a->r);
+    switch (a->nodetype) {
+        case 'N': case '=': case 'D': case 'C':
+            sym = put_symbol(w, a->data.sym);
+            break;
+        case 'I': case 'W': case 'P': /* the reductions of 'P' are in tl */
+            tl = put_node(w, a->data.flow.tl);
+            el = put_node(w, a->data.flow.el);
+            /* fall through */
+        case 'T': /* the 'T' of newfor() has a condition only */
+            cond = put_node(w, a->data.flow.cond);
+            break;
+    }
+
+    put_int(w, R_NODE);
+    put_int(w, a->nodetype);
+    put_int(w, l);
+    put_int(w, r);
+    switch (a->nodetype) {
+        case 'K': fwrite(&a->data.number, sizeof(double), 1, w->f); break;
+        case 'S': put_bytes(w, a->data.s, string_length(a->data.s)); break;
+        case 'F': put_int(w, a->data.functype); break;
+        case 'N': case '=': case 'D': case 'C': put_int(w, sym); break;
+        case 'I': case 'W': case 'P': put_int(w, tl); put_int(w, el); /* fall through */
+        case 'T': put_int(w, cond); break;
+    }
+    return add_object(w, number_of(w, a));
+}
+
+/* Reading: the records are checked once without building anything, so
+   that a file that is cut short or damaged is just not used, then read
+   again to build the tree. The objects are in objects[], their records
+   in kinds[] */
+struct reader {
+    const char *p, *end;
+    int count;
+    char *kinds;
+    void **objects;
+    int build;
+};
+
+static int get_int(struct reader *r, int *v) {
+    int32_t x;
+
+    if (r->end - r->p < (long)sizeof(x)) return 0;
+    memcpy(&x, r->p, sizeof(x));
+    r->p += sizeof(x);
+    *v = x;
+    return 1;
+}
+
+static int get_bytes(struct reader *r, const char **s, int *length) {
+    if (!get_int(r, length) || *length < 0 || r->end - r->p < *length) return 0;
+    *s = r->p;
+    r->p += *length;
+    return 1;
+}
+
+/* object n, made by a record before the one at i, of one of the kinds
+   a and b, or none when optional */
+static int get_ref(struct reader *r, int i, int a, int b, int optional, void **object) {
+    int n;
+
+    if (!get_int(r, &n) || n < -1 || n >= i || (n < 0 && !optional)) return 0;
+    if (n >= 0 && r->kinds[n] != a && r->kinds[n] != b) return 0;
+    *object = n >= 0 ? r->objects[n] : NULL;
+    return 1;
+}
+
+static int get_node(struct reader *r, int i, struct ast **a) {
+    return get_ref(r, i, R_NODE, R_NODE, 1, (void **)a);
+}
+
+static int read_node(struct reader *r, int i) {
+    struct ast *left, *right, *cond = NULL, *tl = NULL, *el = NULL, *a;
+    struct symbol *sym = NULL;
+    const char *s = NULL;
+    double number = 0;
+    int nodetype, length = 0, functype = 0;
+
+    if (!get_int(r, &nodetype) || !get_node(r, i, &left) || !get_node(r, i, &right)) return 0;
+    switch (nodetype) {
+        case 'K':
+            if (r->end - r->p < (long)sizeof(double)) return 0;
+            memcpy(&number, r->p, sizeof(double));
+            r->p += sizeof(double);
+            break;
+        case 'S': if (!get_bytes(r, &s, &length)) return 0; break;
+        case 'F': if (!get_int(r, &functype)) return 0; break;
+        case 'N': case '=': case 'D': case 'C':
+            if (!get_ref(r, i, R_SYMBOL, R_FUNCTION, 0, (void **)&sym)) return 0;
+            break;
+        case 'I': case 'W': case 'P':
+            if (!get_node(r, i, &tl) || !get_node(r, i, &el)) return 0;
+            /* fall through */
+        case 'T':
+            if (!get_node(r, i, &cond)) return 0;
+            break;
+    }
+    if (!r->build) return 1;
+
+    a = nodetype == 'S' ? newstr((char *)s, length) : newast(nodetype, left, right);
+    a->l = left;
+    a->r = right;
+    switch (nodetype) {
+        case 'K': a->data.number = number; break;
+        case 'F': a->data.functype = functype; break;
+        case 'N': case '=': case 'D': case 'C': a->data.sym = sym; break;
+        case 'I': case 'W': case 'T': case 'P':
+            a->data.flow.cond = cond;
+            a->data.flow.tl = tl;
+            a->data.flow.el = el;
+            break;
+    }
+    r->objects[i] = a;
+    return 1;
+}
+
+static int read_symbol(struct reader *r, int i, int kind) {
+    struct symlist *syms = NULL, **last = &syms;
+    struct ast *body;
+    struct symbol *s;
+    const char *name;
+    int type, length, nparams = 0;
+
+    if (!get_int(r, &type) || !get_bytes(r, &name, &length) || length == 0) return 0;
+    if (r->build) {
+        s = newsym((char *)name, length);
+        s->type = type;
+        r->objects[i] = s;
+    }
+    if (kind == R_SYMBOL) return 1;
+
+    if (!get_int(r, &nparams) || nparams < 0) return 0;
+    for (int k = 0; k < nparams; k++) {
+        struct symbol *param;
+
+        if (!get_ref(r, i, R_SYMBOL, R_SYMBOL, 0, (void **)&param)) return 0;
+        if (r->build) {
+            *last = newsymlist(param, NULL);
+            last = &(*last)->next;
+        }
+    }
+    if (!get_node(r, i, &body)) return 0;
+    if (r->build) dodef(r->objects[i], syms, body);
+    return 1;
+}
+
+/* the records, checked or built: returns the root or 0 when they are
+   damaged */
+static int read_records(struct reader *r, int root, struct ast **tree) {
+    int in_body = 0;
+
+    for (int i = 0; i < r->count; i++) {
+        int kind;
+
+        if (!get_int(r, &kind)) return 0;
+        r->kinds[i] = kind;
+        r->objects[i] = NULL;
+        switch (kind) {
+            case R_NODE:
+                if (!read_node(r, i)) return 0;
+                break;
+            case R_SYMBOL:
+                if (!read_symbol(r, i, kind)) return 0;
+                break;
+            case R_BODY:
+                if (in_body) return 0;
+                in_body = 1;
+                if (r->build) arena_begin(); /* the body gets an arena of its own */
+                break;
+            case R_FUNCTION:
+                if (!in_body || !read_symbol(r, i, kind)) return 0;
+                in_body = 0;
+                break;
+            default:
+                return 0;
+        }
+    }
+    if (in_body || r->p != r->end || root < -1 || root >= r->count) return 0;
+    if (root >= 0 && r->kinds[root] != R_NODE) return 0;
+    *tree = root >= 0 ? r->objects[root] : NULL;
+    return 1;
+}
+
+/* the tree of a cache file of the text of digest, 0 when it is not one */
+static int load(const char *path, const unsigned char *digest, size_t length, struct ast **tree) {
+    struct cache_header h;
+    struct reader r = { 0 };
+    struct stat st;
+    char *base;
+    int fd = open(path, O_RDONLY), ok = 0;
+
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(h)) {
+        close(fd);
+        return 0;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+    memcpy(&h, base, sizeof(h));
+    if (!memcmp(h.magic, "SYC", 4) && !strncmp(h.build, CACHE_BUILD, sizeof(h.build))
+            && h.length == length && !memcmp(h.digest, digest, DIGEST) && h.count >= 0) {
+        r.count = h.count;
+        r.kinds = malloc(h.count + 1);
+        r.objects = malloc((h.count + 1) * sizeof(void *));
+        if (!r.kinds || !r.objects) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+        r.p = base + sizeof(h);
+        r.end = base + st.st_size;
+        if (read_records(&r, h.root, tree)) {
+            r.p = base + sizeof(h);
+            r.build = 1;
+            ok = read_records(&r, h.root, tree);
+        }
+        free(r.kinds);
+        free(r.objects);
+    }
+    munmap(base, st.st_size);
+    return ok;
+}
+
+/* the directory of the cache: $SYNTHAX_CACHE or ~/.cache/synthax, made if
+   needed. 0 when there is none */
+static int cache_dir(char *dir, size_t size) {
+    const char *env = getenv("SYNTHAX_CACHE"), *home = getenv("HOME");
+
+    if (env && *env) {
+        snprintf(dir, size, "%s", env);
+    } else if (home && *home) {
+        snprintf(dir, size, "%s/.cache", home);
+        mkdir(dir, 0755);
+        snprintf(dir, size, "%s/.cache/synthax", home);
+    } else {
+        return 0;
+    }
+    return !mkdir(dir, 0755) || errno == EEXIST;
+}
+
+/* the file save_program() writes the tree of the script being parsed to */
+struct cache_entry {
+    char path[4096];
+    unsigned char digest[DIGEST];
+    size_t length;
+};
+
+void save_program(struct ast *a) {
+    struct cache_entry *pd = ctx->cache;
+    struct cache_header h = { "SYC" };
+    struct writer w = { 0 };
+    char tmp[4096 + 16];
+    int fd, ok;
+
+    if (!pd) return;
+    ctx->cache = NULL;
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", pd->path);
+    if ((fd = mkstemp(tmp)) < 0) return;
+    fchmod(fd, 0644); /* as the other files of the directory */
+    w.f = fdopen(fd, "wb");
+    if (!w.f) {
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    w.tmp = tmp;
+    w.size = 1024;
+    w.objects = calloc(w.size, sizeof(void *));
+    w.numbers = malloc(w.size * sizeof(int));
+    if (!w.objects || !w.numbers) out_of_memory(&w);
+    fwrite(&h, sizeof(h), 1, w.f);
+    h.root = put_node(&w, a);
+    strncpy(h.build, CACHE_BUILD, sizeof(h.build));
+    memcpy(h.digest, pd->digest, DIGEST);
+    h.length = pd->length;
+    h.count = w.count;
+    ok = !ferror(w.f) && !fseek(w.f, 0, SEEK_SET) && fwrite(&h, sizeof(h), 1, w.f) == 1;
+    ok = !fclose(w.f) && ok;
+    /* the file appears whole or not at all, for the runs that read it */
+    if (!ok || rename(tmp, pd->path) < 0) unlink(tmp);
+    free(w.objects);
+    free(w.numbers);
+}
+
+/* Runs the script of f as run_file() does, from the cache when it has the
+   tree of the text of f, otherwise saving the tree in the cache */
+void run_cached(FILE *f) {
+    struct stat st;
+    struct cache_entry pd;
+    char dir[4000], name[33];  /* half the digest is enough for a name */
+    struct ast *tree;
+    char *text;
+
+    if (fstat(fileno(f), &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || !cache_dir(dir, sizeof(dir))) {
+        run_file(f, 0);
+        return;
+    }
+    text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (text == MAP_FAILED) {
+        run_file(f, 0);
+        return;
+    }
+    pd.length = st.st_size;
+    digest_text(text, pd.length, pd.digest);
+    for (int i = 0; i < 16; i++) sprintf(name + 2 * i, "%02x", pd.digest[i]);
+    snprintf(pd.path, sizeof(pd.path), "%s/%s.syc", dir, name);
+    if (load(pd.path, pd.digest, pd.length, &tree)) {
+        munmap(text, st.st_size);
+        /* the errors stop the script, as when it is parsed from the mapping */
+        yyset_in(f, ctx->scanner);
+        map_input(f, ctx->scanner);
+        resolve_unit(tree);
+        execute(tree);
+        print_ast(tree, 0, " ");
+        arena_free_program();
+        unmap_input(ctx->scanner);
+        return;
+    }
+    munmap(text, st.st_size);
+    ctx->cache = &pd;
+    run_file(f, 0);
+    ctx->cache = NULL;
+}
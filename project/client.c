@@ -0,0 +1,131 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <limits.h>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+
+/* synthax-client: runs a script on a daemon started by synthax --serve,
+   see serve.c for the requests it sends.
+
+       synthax-client socket script [name=value ...] [name ...]
+
+   name=value binds the input variable name to a number, or to a string
+   when value is not a number. A name alone asks for the value the
+   variable has after the run. What the script printed is written to
+   stdout, then a line name = value for each variable asked for. The exit
+   status is 1 when an error stopped the script. */
+
+static int connect_to(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+            || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void send_request(FILE *out, const char *script, char **args, int nargs) {
+    fprintf(out, "run %s\n", script);
+    for (int i = 0; i < nargs; i++) {
+        char *value = strchr(args[i], '='), *end;
+        int name;
+
+        if (!value) continue;
+        name = value - args[i];
+        strtod(++value, &end);
+        if (*value && !*end)
+            fprintf(out, "num %.*s %s\n", name, args[i], value);
+        else
+            fprintf(out, "str %.*s %zu\n%s\n", name, args[i], strlen(value), value);
+    }
+    for (int i = 0; i < nargs; i++) {
+        if (!strchr(args[i], '=')) fprintf(out, "get %s\n", args[i]);
+    }
+    fprintf(out, "end\n");
+    fflush(out);
+}
+
+/* copies the n bytes of a value or of the output */
+static int copy(FILE *in, FILE *out, long n) {
+    char buffer[BUFSIZ];
+
+    while (n > 0) {
+        size_t k = fread(buffer, 1, n < (long)sizeof(buffer) ? n : (long)sizeof(buffer), in);
+
+        if (k == 0) return 0;
+        fwrite(buffer, 1, k, out);
+        n -= k;
+    }
+    return 1;
+}
+
+/* the exit status of the answer, 1 when it is cut short */
+static int read_answer(FILE *in) {
+    char name[256];
+    long length;
+    int status;
+
+    if (fscanf(in, "output %ld", &length) != 1 || getc(in) != '\n' || !copy(in, stdout, length))
+        return 1;
+    for (;;) {
+        char kind[8];
+
+        if (fscanf(in, "%7s", kind) != 1) return 1;
+        if (!strcmp(kind, "status"))
+            return fscanf(in, "%d", &status) == 1 ? status : 1;
+        if (fscanf(in, " %255s", name) != 1) return 1;
+        if (!strcmp(kind, "num")) {
+            double number;
+
+            if (fscanf(in, "%lf", &number) != 1) return 1;
+            printf("%s = %g\n", name, number);
+        } else if (!strcmp(kind, "str")) {
+            if (fscanf(in, "%ld", &length) != 1 || getc(in) != '\n') return 1;
+            printf("%s = ", name);
+            if (!copy(in, stdout, length)) return 1;
+            putchar('\n');
+        } else {
+            printf("%s is not set\n", name);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    char script[PATH_MAX];
+    FILE *in, *out;
+    int fd, status;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s socket script [name=value ...] [name ...]\n", argv[0]);
+        return 1;
+    }
+    /* the daemon runs in a directory of its own */
+    if (!realpath(argv[2], script)) {
+        perror(argv[2]);
+        return 1;
+    }
+    if ((fd = connect_to(argv[1])) < 0) return 1;
+    in = fdopen(fd, "r");
+    out = fdopen(dup(fd), "w");
+    if (!in || !out) {
+        perror(argv[1]);
+        return 1;
+    }
+    send_request(out, script, argv + 3, argc - 3);
+    shutdown(fd, SHUT_WR);
+    status = read_answer(in);
+    fclose(out);
+    fclose(in);
+    return status;
+}
@@ -0,0 +1,76 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include "helper.h"
+
+/* Context the calling thread works on: a thread running a script makes a
+   context of its own and uses it before parsing, see parser.y */
+__thread struct synthax_ctx *ctx = NULL;
+
+struct synthax_ctx *synthax_ctx_new() {
+    struct synthax_ctx *c = calloc(1, sizeof(struct synthax_ctx));
+    if (!c) {
+        fprintf(stderr, "Error in memory: impossible to create a context.\n");
+        exit(1);
+    }
+    c->scope_stack = c->initial_scopes;
+    c->scope_stack_size = INITIAL_SCOPE_DEPTH;
+    c->engine = ENGINE_TREE;
+    c->program = c->current = arena_new();
+    c->scanner = new_scanner();
+    return c;
+}
+
+void synthax_ctx_use(struct synthax_ctx *c) {
+    ctx = c;
+}
+
+/* Free a context and everything in it, the context of the thread is left
+   unset if it was c */
+void synthax_ctx_free(struct synthax_ctx *c) {
+    struct synthax_ctx *outer = ctx;
+
+    ctx = c;
+    arena_free(c->previous);
+    free_scopes();
+    tree_free();
+    vm_free();
+    tasks_free(c->tasks);
+    free_scanner(c->scanner);
+    ctx = outer == c ? NULL : outer;
+    free(c);
+}
+
+/* Context of a thread helping the one of c run a parallel loop, see
+   parallel.c, used by the calling thread from now on: it sees the
+   variables of c, whose scopes it shares, and has its own stacks, tree
+   arena and scopes pushed on top of the shared ones. Nothing of c may
+   change while it is in use */
+struct synthax_ctx *synthax_ctx_share(struct synthax_ctx *c) {
+    struct synthax_ctx *w = calloc(1, sizeof(struct synthax_ctx));
+    if (!w) {
+        fprintf(stderr, "Error in memory: impossible to create a context.\n");
+        exit(1);
+    }
+    ctx = w;
+    share_scopes(c);
+    w->engine = c->engine;
+    w->frame_scope = c->frame_scope;
+    w->values_shared = 1; /* the values of c, see share_values() */
+    w->frozen = c->frozen;
+    w->program = w->current = arena_new();
+    w->scanner = c->scanner; /* for the line of the errors */
+    return w;
+}
+
+/* Free a context of synthax_ctx_share() whose own scopes have been
+   popped, the variables it shared are left as they are. The context of
+   the thread is left unset */
+void synthax_ctx_unshare(struct synthax_ctx *w) {
+    ctx = w;
+    unshare_scopes();
+    tree_free();
+    vm_free();
+    ctx = NULL;
+    free(w);
+}
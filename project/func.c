@@ -5,6 +5,35 @@
 # include <math.h>
 # include "helper.h"
 
+#ifdef ALLOC_DEBUG
+/* allocations made so far, to check that a piece of code makes none */
+long alloc_count = 0;
+
+void *counted_malloc(size_t size) {
+    alloc_count++;
+    return (malloc)(size);
+}
+
+void *counted_calloc(size_t n, size_t size) {
+    alloc_count++;
+    return (calloc)(n, size);
+}
+
+void *counted_realloc(void *p, size_t size) {
+    alloc_count++;
+    return (realloc)(p, size);
+}
+
+char *counted_strdup(const char *s) {
+    alloc_count++;
+    return (strdup)(s);
+}
+
+void alloc_report() {
+    fprintf(stderr, "allocations: %ld\n", alloc_count);
+}
+#endif
+
 /* factorial built in function*/
  double factorial(double n) {
     if (n < 0) return NAN; // Undefined for negative numbers
@@ -16,69 +45,49 @@
     return result;
 }
 
+/* print a single argument of the print built in function */
+void print_value(val_t value) {
+    if (value.type == 1) {
+        printf("%g", value.data.number);
+    } else if (value.type == 2) {
+        printf("%s", value.data.string);
+    } else if (value.type == 3) {
+        print_list(value.data.list);
+    } else {
+        yyerror("Unsupported type in print");
+    }
+}
+
 /* print built in function */
 void print_func(struct ast *arg) {            
 struct ast *current = arg; 
 val_t value;
 
     while (current) {
-        if (current->l){  
+        if (current->nodetype == '['){  /* arguments but the last one */
          value = eval(current->l); 
         }
         else {
             value = eval(current);
         }
-        if (value.type == 1) {
-            printf("%g", value.data.number);
-        } else if (value.type == 2) {
-            printf("%s", value.data.string);
-        } else if (value.type == 3) {
-            print_list(value.data.list);
-        } else {
-            yyerror("Unsupported type in print");
-        }
+        print_value(value);
+        drop_value(value);
 
         //separate space between arguments
-        if (current->r) {
+        if (current->nodetype == '[') {
             printf(" ");
+            current = current->r; // Next argument
+        } else {
+            current = NULL;
         }
-        current = current->r; // Next argument
-    }
-}
-
-/* Returns the size of a list */
-int list_length(struct list *head) {
-    int count = 0;
-    while (head) {
-        count++;
-        head = head->next;
-    }
-    return count;
-}
-
-/* Access a particular element of the list */
-val_t *get(struct list *head, int index) {
-    int i = 0;
-    while (head) {
-        if (i == index) {
-            return head->value;  // Returns the current value
-        }
-        head = head->next;
-        i++;
     }
-    return NULL;  // Return null if value is out of bounds
 }
 
 /*
 val_t *get2D(struct list *head, int row, int col) {
-    int i = 0;
-    while (head) { // Iteriamo sulle righe (lista esterna)
-        if (i == row) { // Se siamo nella riga giusta
-            struct list *inner_list = head->value->data.list; // Lista interna (colonne)
-            return get(inner_list, col); // Usiamo get() per ottenere la colonna
-        }
-        head = head->next;
-        i++;
+    val_t *inner = get(head, row); // Riga (lista esterna)
+    if (inner && inner->type == 3) {
+        return get(inner->data.list, col); // Usiamo get() per ottenere la colonna
     }
     return NULL; // Se gli indici sono fuori dai limiti
 } */
@@ -117,36 +126,13 @@ val_t split(val_t v) {
         return (val_t){.type = 3, .data.list = NULL}; 
     }
 
-    char *input = strdup(v.data.string); 
+    char *input = strdup(v.data.string); // strtok() writes to it
     char *token = strtok(input, " "); // Divides the string in words
     struct list *head = NULL;
-    struct list *current = NULL;
 
     while (token != NULL) {
-        struct list *new_node = (struct list *)malloc(sizeof(struct list));
-        if (!new_node) {
-            yyerror("Out of memory");
-            exit(1);
-        }
-
-        val_t *value = (val_t *)malloc(sizeof(val_t));
-        if (!value) {
-            yyerror("Out of memory");
-            exit(1);
-        }
-
-        value->type = 2; 
-        value->data.string = strdup(token); 
-
-        new_node->value = value;
-        new_node->next = NULL;
-
-        if (!head) {
-            head = new_node; 
-        } else {
-            current->next = new_node;
-        }
-        current = new_node;
+        if (!head) head = new_list(0);
+        list_push(head, (val_t){.type = 2, .data.string = new_string(token, strlen(token))});
 
         token = strtok(NULL, " ");
     }
@@ -156,45 +142,15 @@ val_t split(val_t v) {
     return (val_t){.type = 3, .data.list = head}; 
 }
 
-/* Create a linked list from an AST structure */
+/* Create a list from an AST structure */
 struct list *linked_list_ast(struct ast *args) {
-    struct list *head = NULL;  // Head of the linked list
-    struct list *current = NULL;
+    struct list *head = NULL;
 
     while (args) {
-        struct list *new_node = (struct list *)malloc(sizeof(struct list));
-        if (!new_node) {
-            yyerror("Out of memory");
-            exit(1);
-        }
-    
-        val_t *value = (val_t *)malloc(sizeof(val_t));
-        if (!value) {
-            yyerror("Out of memory");
-            exit(1);
-        }
-        val_t result = eval(args);
-        
-        if (result.type == 1) { 
-            value->type = 1;
-            value->data.number = result.data.number;
-        } else if (result.type == 2) { 
-            value->type = 2;
-            value->data.string = strdup(result.data.string);
-        } else if (result.type == 3) { 
-            value->type = 3;
-            value->data.list = result.data.list;
-        }
-
-        new_node->value = value;
-        new_node->next = NULL;
+        val_t value = eval(args); // The list keeps the reference to a string or a list
 
-        if (!head) {
-            head = new_node;  // First node is the head
-        } else {
-            current->next = new_node;  
-        }
-        current = new_node;
+        if (!head) head = new_list(0);
+        list_push(head, value);
 
         if (args->nodetype == '[') {  
             args = args->r;           
@@ -205,55 +161,26 @@ struct list *linked_list_ast(struct ast *args) {
     return head;
 }
 
-void print_list(struct list *lst) {
-    printf("(");
-    struct list *current = lst;
-    while (current) {
-        if (current->value->type == 3) {
-            print_list(current->value->data.list); 
-        } else if (current->value->type == 1) {
-            printf("%.2f", current->value->data.number);
-        } else if (current->value->type == 2) {
-            printf("\"%s\"", current->value->data.string);
-        }
-        if (current->next) {
-            printf(", ");
-        }
-        current = current->next;
+static void print_element(val_t *value, void *first) {
+    if (!*(int *)first) {
+        printf(", ");
     }
-    printf(")");
-}
-
-struct list *concat_lists(struct list *l1, struct list *l2) {
-    struct list *new_list = NULL, *current = NULL;
-
-    // Copy the first list
-    while (l1) {
-        struct list *new_node = malloc(sizeof(struct list));
-        new_node->value = l1->value;
-        new_node->next = NULL;
-
-        if (!new_list) new_list = new_node;
-        else current->next = new_node;
-        current = new_node;
-
-        l1 = l1->next;
+    *(int *)first = 0;
+    if (value->type == 3) {
+        print_list(value->data.list); 
+    } else if (value->type == 1) {
+        printf("%.2f", value->data.number);
+    } else if (value->type == 2) {
+        printf("\"%s\"", value->data.string);
     }
+}
 
-    // Copy the second list
-    while (l2) {
-        struct list *new_node = malloc(sizeof(struct list));
-        new_node->value = l2->value;
-        new_node->next = NULL;
-
-        if (!new_list) new_list = new_node;
-        else current->next = new_node;
-        current = new_node;
-
-        l2 = l2->next;
-    }
+void print_list(struct list *lst) {
+    int first = 1;
 
-    return new_list;
+    printf("(");
+    list_foreach(lst, print_element, &first);
+    printf(")");
 }
 
 val_t count_char(val_t v) {
@@ -261,7 +188,7 @@ val_t count_char(val_t v) {
     result.type = 1; 
 
     if (v.type == 2 && v.data.string) { 
-        result.data.number = strlen(v.data.string); 
+        result.data.number = string_length(v.data.string); 
     } else {
         yyerror("char_count() expects a string");
         result.data.number = 0; 
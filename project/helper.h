@@ -1,12 +1,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
-#define MAX_SCOPE_DEPTH 128
+#include <setjmp.h>
+#define INITIAL_SCOPE_DEPTH 128
 
-extern int yylineno; /* from lexer */
-extern FILE *yyin; 
 void yyerror(const char *s, ...);
 
+/* Scanner, of lex.yy.c or scanner.c: each context has one, the state of
+   a reentrant flex scanner */
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+yyscan_t new_scanner();
+void free_scanner(yyscan_t scanner);
+void yyset_in(FILE *f, yyscan_t scanner);
+int yyget_lineno(yyscan_t scanner);
+int map_input(FILE *f, yyscan_t scanner);
+int map_string(const char *text, size_t length, yyscan_t scanner);
+void unmap_input(yyscan_t scanner);
+int input_read_whole(yyscan_t scanner);
+void interactive_input(int on, yyscan_t scanner);
+
+/* A string or a list in a val_t is a reference to a shared string (see
+   str.c) or list (see list.c) held by whoever holds the value: eval() hands
+   one to its caller, which keeps it (in a variable or a list) or gives it
+   back with drop_value(). Numbers own nothing, so evaluating numeric
+   expressions never allocates. */
 typedef struct value {
     int type;               // Type of value: 1 = number, 2 = string, 3 = list
     union {
@@ -16,26 +36,37 @@ typedef struct value {
     } data;
 }val_t;
 
+struct lnode; /* see list.c */
+
 struct list {
-    val_t *value;            // Value of the element
-    struct list *next;    // Pointer to next element
+    struct lnode *root;   // Elements shared with other lists, never changed
+    val_t *values;        // Elements after the ones of root, owned by this list
+    int count;            // Number of elements in values
+    int capacity;         // Allocated elements
+    int front;            // Free elements allocated before values
+    int length;           // Number of elements
+    int refs;             // Variables, lists and values holding this list
 };
 
 /* symbol table */
 struct symbol { /* a variable name */
- char *name;
+ char *name; /* an atom: equal names are the same pointer */
  double value;
  struct ast *func; /* stmt for the function */
  struct symlist *syms; /* list of dummy args */
  int type;
- char *string;
+ char *string; /* shared, see str.c */
  struct list *list;
+ struct arena *arena; /* nodes of the body */
+ struct bytecode *code; /* compiled body, filled on first call by the vm */
+ int nslots; /* size of the scope of a function, set by the resolver */
 };
 
 /* list of symbols, for an argument list */
 struct symlist {
  struct symbol *sym;
  struct symlist *next;
+ int slot; /* slot of the parameter in the scope of the function */
 };
 
 enum bifs { /* built-in functions */
@@ -53,8 +84,14 @@ enum bifs { /* built-in functions */
     B_split,
     B_casual,
    /* B_get2D, */
-    B_count_char
-    
+    B_count_char,
+    /* taking a function, map(l, f), filter(l, f) and reduce(l, f, init):
+       the arguments are a '[' chain whose second element is the 'N' of
+       the function, see parallel.c */
+    B_map,
+    B_filter,
+    B_reduce,
+    B_await     /* await(x) of the task x a spawn gave, see parallel.c */
 };
 
 /* Nodes in the abstract syntax tree */
@@ -74,11 +111,26 @@ struct ast {
         } flow;
     
     } data;
+    /* lexical address set by the resolver for 'N', '=', 'D' and 'C' nodes:
+       the variable is slot in the scope depth levels below the current one,
+       depth -1 means it is looked up by name. 'W', 'T' and 'P' keep the
+       number of slots of the scope they open in slot. */
+    int depth;
+    int slot;
 };
 
 /* Symbol table functions */
+char *intern(const char *name, size_t length);
 struct symbol *lookup(char*);
 struct symbol *declare(char*);
+struct symbol *find_symbol(char *name);
+struct symbol *slot_at(int depth, int slot);
+struct symbol *lookup_at(int depth, int slot, char *name);
+struct symbol *declare_at(int slot, char *name);
+struct symbol *declare_symbol(int slot, struct symbol *decl);
+int global_slot(char *name);
+void mark_by_name(char *name);
+int scopes_seen_by_name(int from);
 struct symlist *newsymlist(struct symbol *sym, struct symlist *next);
 void symlistfree(struct symlist *sl);
 
@@ -93,22 +145,40 @@ struct ast *newdeclare(struct symbol *name);
 struct ast *newref(struct symbol *s);
 struct ast *newasgn(struct symbol *s, struct ast *v);
 struct ast *newnum(double d);
-struct ast *newstr (char *s);
+struct ast *newstr(char *s, size_t length);
 struct ast *newflow(int nodetype, struct ast *cond, struct ast *tl, struct ast *tr);
 struct ast *newfor(struct ast *init, struct ast *cond, struct ast *inc, struct ast *body);
+struct ast *newparfor(struct ast *init, struct ast *cond, struct ast *inc, struct ast *body, struct ast *reductions);
+/* is n a reference to the variable assigned by a */
+int same_variable(struct ast *a, struct ast *n);
 /* define a function */
 void dodef(struct symbol *name, struct symlist *syms, struct ast *stmts);
 /* evaluate an AST */
 val_t eval(struct ast *);
+/* call a user function with values given to it */
+val_t call_function(struct symbol *fn, val_t *args, int nargs);
 /* optimize the AST */
 void optimize_ast(struct ast *node);
-/* delete and free an AST */
-void treefree(struct ast *);
+/* bind variables to lexical addresses */
+void resolve_unit(struct ast *a);
+int resolve_function(struct symlist *syms, struct ast *body);
+/* arenas the AST nodes are allocated from */
+struct arena;
+struct arena *arena_new();
+void arena_begin();
+struct arena *arena_end();
+void arena_free(struct arena *ar);
+void arena_free_program();
+void arena_retire(struct arena *body, struct symlist *syms);
+struct arena *arena_take();
+struct symbol *newsym(char *name, size_t length);
 void print_ast(struct ast *node, int depth, char *prefix);
 
 /* Functions */
 double roman_to_int(const char *roman);
 void print_val(val_t val);
+void print_value(val_t val);
+val_t apply_builtin(enum bifs functype, val_t v);
 double factorial(double n);
 void print_func(struct ast *arg);
 val_t split(val_t v);
@@ -116,22 +186,228 @@ val_t split(val_t v);
 /* Linked List Functions*/
 void print_list(struct list *lst);
 struct list *linked_list_ast(struct ast *args);
+val_t element_of_value(val_t v);
+void drop_value(val_t v);
+struct list *list_of_value(val_t v);
+struct list *new_list(int capacity);
+void list_push(struct list *lst, val_t v);
+void list_retain(struct list *lst);
+void list_release(struct list *lst);
+int list_add_in_place(struct symbol *sym, struct list *lst, val_t v, struct list *elems, int front);
 int list_length(struct list *head);
+void list_foreach(struct list *lst, void (*fn)(val_t *, void *), void *ctx);
+void list_foreach_range(struct list *lst, int first, int end, void (*fn)(val_t *, void *), void *ctx);
 val_t *get(struct list *head, int index);
 val_t *get2D(struct list *head, int row, int col);
 struct list *concat_lists(struct list *head1, struct list *head2);
+void share_values();
+void unshare_values();
 val_t count_char(val_t v);
 
+/* String Functions */
+char *new_string(const char *s, size_t length);
+char *concat_strings(char *a, char *b);
+char *add_strings(char *a, char *b);
+int string_add_in_place(struct symbol *sym, char *s, char *b);
+size_t string_length(char *s);
+int string_equal(char *a, char *b);
+void string_retain(char *s);
+void string_release(char *s);
+char *symbol_string(struct symbol *sym);
+
 /* Scope*/
 typedef struct scope {
-    struct symbol *symtab;  
+    struct symbol *symtab;  /* slots, handed out by the resolver */
     int symtab_size;
     int symtab_count;
+    int extras;             /* variables created by name at run time */
 } scope_t;
 
-void push_scope();
+void push_scope(int nslots);
 void pop_scope();
 void print_all_scopes();
+void clear_globals();
+void free_scopes();
+struct synthax_ctx;
+void share_scopes(struct synthax_ctx *from);
+void unshare_scopes();
+
+#ifdef ALLOC_DEBUG
+/* make ALLOC_DEBUG=1 counts the allocations, reported on exit */
+#include <string.h>
+extern long alloc_count;
+void *counted_malloc(size_t size);
+void *counted_calloc(size_t n, size_t size);
+void *counted_realloc(void *p, size_t size);
+char *counted_strdup(const char *s);
+void alloc_report();
+#define malloc(size) counted_malloc(size)
+#define calloc(n, size) counted_calloc(n, size)
+#define realloc(p, size) counted_realloc(p, size)
+#define strdup(s) counted_strdup(s)
+#endif
+
+/* Bytecode */
+enum opcode {
+    OP_NUM,         /* push k.number */
+    OP_STR,         /* push a copy of k.s */
+    OP_NULL,        /* null expression: report it and push 0 */
+    OP_LOAD,        /* push the value of variable k.sym */
+    OP_STORE,       /* assign the top of the stack to k.sym, arg = 1 if it is a list literal */
+    OP_STORE_INIT,  /* declaration without initializer for k.sym */
+    OP_STORE_ADD,   /* k.sym = k.sym + x or x + k.sym, arg as OP_ADD, bit 2 when k.sym is on the right */
+    OP_DECLARE,     /* declare k.sym in the current scope */
+    OP_ADD,         /* arg: bit 0 left is a list literal, bit 1 right is a list literal */
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_MOD,
+    OP_ABS,
+    OP_NEG,
+    OP_NOT,
+    OP_CMP,         /* arg: comparison nodetype ('1'..'6', 'O', '&') */
+    OP_CHAIN,       /* pop arg list literal elements, push its value */
+    OP_LISTLIT,     /* like OP_CHAIN, but also keep the elements as a list below the value */
+    OP_JMP,         /* jump to arg */
+    OP_JZ,          /* pop, jump to arg if zero */
+    OP_JNZ,         /* pop, jump to arg if not zero */
+    OP_POP,
+    OP_SETLAST,     /* pop into the value of the last statement */
+    OP_PUSHLAST,
+    OP_SCOPE,
+    OP_UNSCOPE,
+    OP_CALL,        /* call user function k.sym with arg arguments */
+    OP_TAILCALL,    /* same, in place of the current frame when it can be dropped */
+    OP_BUILTIN,     /* apply built-in arg to the top of the stack */
+    OP_GET,         /* pop list and index, push the element, arg = 1 if no index was given */
+    OP_PRINT,       /* pop and print, arg = 1 prints a separator */
+    OP_RET,         /* return the top of the stack */
+    OP_RETLAST,     /* return the value of the last statement */
+    OP_PARFOR,      /* run the 'P' loop k.loop on threads and jump to arg, or go on with it as a 'T' */
+    OP_APPLY,       /* pop the list, and the initial value for reduce, apply built-in arg with function k.sym */
+    OP_SPAWN,       /* spawn user function k.sym with arg arguments, push the task */
+    OP_AWAIT,       /* pop a task, push its result */
+    OP_HALT
+};
+
+struct instr {
+    int op;
+    int arg;
+    int depth, slot; /* lexical address of k.sym, see struct ast */
+    union {
+        double number;
+        char *s;
+        struct symbol *sym;
+        struct ast *loop;
+    } k;
+};
+
+struct bytecode {
+    struct instr *code;
+    int len;
+    int size;
+};
+
+struct bytecode *compile_unit(struct ast *a);
+struct bytecode *compile_function(struct symbol *fn);
+void free_bytecode(struct bytecode *bc);
+void vm_exec(struct bytecode *bc);
+val_t vm_call(struct symbol *fn, val_t *args);
+
+/* Execution engine */
+enum engine { ENGINE_TREE, ENGINE_VM };
+void execute(struct ast *a);
+size_t thread_stack_size();
+void vm_free();
+void tree_free();
+
+/* Parallel loops, parallel.c: the values of a context are shared while
+   the threads of a loop use them, see share_values() in list.c */
+#define values_shared() (ctx && __atomic_load_n(&ctx->values_shared, __ATOMIC_RELAXED))
+int parallel_for(struct ast *a, val_t *v);
+val_t apply_function(enum bifs functype, struct symbol *fn, val_t lst, val_t init);
+struct tasks;
+struct task;
+val_t spawn_task(struct symbol *fn, val_t *args, int nargs);
+val_t await_task(val_t task);
+void tasks_free(struct tasks *ts);
+
+/* Parser, parser.y */
+void run_file(FILE *f, int stream);
+struct ast *parse_program();
+
+/* Cache of parsed scripts, cache.c */
+void run_cached(FILE *f);
+void save_program(struct ast *a);
+
+/* Daemons running scripts for synthax-client, serve.c */
+int serve(const char *path, enum engine engine);
+int zygote(const char *path);
+
+/* Context of an interpreter: everything parsing and running scripts
+   changes, so that independent scripts can run at the same time on
+   threads of their own, each in a context of its own. The interpreter
+   works on the context of the calling thread, ctx, see context.c */
+#define SLOT_CLASSES 28 /* free lists of slot arrays, see symbol_table.c */
+
+struct atom;
+struct frame;
+struct tail_call;
+struct cache_entry;
+struct frozen;
+
+struct synthax_ctx {
+    /* symbol_table.c */
+    scope_t initial_scopes[INITIAL_SCOPE_DEPTH];
+    scope_t *scope_stack;
+    int scope_stack_size;
+    int scope_top;              /* last active scope */
+    struct atom **atoms;
+    int atom_count;
+    int atom_buckets;
+    char **global_names;
+    int global_size;
+    int *local_count;
+    int untracked;
+    char *by_name;
+    struct symbol *free_slots[SLOT_CLASSES];
+
+    /* abstract_syntax_tree.c */
+    int return_flag;            /* a give_back is unwinding the tree walk */
+    int frame_scope;            /* scope of the running function, 0 outside */
+    struct tail_call *tail;     /* give_back f(...) pending, see calluser() */
+    struct arena *program;
+    struct arena *current;      /* arena new nodes go to */
+
+    /* vm.c */
+    enum engine engine;
+    val_t *stack, *stack_end;
+    struct frame *frames, *frames_end;
+    size_t stack_used, frames_used; /* by the vm_exec() that called a built-in, see vm_call() */
+    int halted;
+
+    /* parallel.c */
+    struct tasks *tasks;        /* spawned by the script, see spawn_task() */
+    struct task *running;       /* task this context runs, NULL for the script */
+    int values_shared;          /* threads of the pool use the values, see list.c */
+    struct frozen *frozen;      /* trees replaced meanwhile, see freeze() */
+
+    /* parser.y */
+    yyscan_t scanner;
+    int start_token;
+    struct arena *previous;     /* statement run before, see run_statement() */
+    struct ast *parsed;         /* tree of parse_program() */
+    struct cache_entry *cache;  /* where the tree parsed goes, see run_cached() */
+    jmp_buf *stop;              /* where errors go instead of exit(), see run_script() */
+};
+
+extern __thread struct synthax_ctx *ctx;
+struct synthax_ctx *synthax_ctx_new();
+void synthax_ctx_free(struct synthax_ctx *c);
+void synthax_ctx_use(struct synthax_ctx *c);
+struct synthax_ctx *synthax_ctx_share(struct synthax_ctx *c);
+void synthax_ctx_unshare(struct synthax_ctx *w);
 
 
 
@@ -0,0 +1,106 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include "helper.h"
+# include "parser.tab.h"
+
+/* Lexing throughput of the scanner this is linked with (make lexbench):
+   the scripts are mapped as synthax does and scanned to the end, without
+   parsing them, and the MB/s are printed. With -t the tokens are printed
+   instead, one per line with the line number and the value, so the
+   output of lexbench_flex and lexbench_simd on a script can be compared */
+
+int yylex(YYSTYPE *lval, yyscan_t scanner);
+void yyset_lineno(int lineno, yyscan_t scanner);
+
+static yyscan_t scanner;
+static YYSTYPE yylval;  /* the parser is not linked */
+
+static void print_token(int token) {
+    printf("%d %d", yyget_lineno(scanner), token);
+    switch (token) {
+        case NUM: case BINARY: case ROMAN:
+            printf(" %.17g", yylval.num);
+            break;
+        case STR:
+            printf(" <<%.*s>>", (int)yylval.st.length, yylval.st.s);
+            break;
+        case ID:
+            printf(" %s", yylval.s->name);
+            break;
+        case FUNC: case CMP:
+            printf(" %d", yylval.fn);
+            break;
+        case DATA_TYPE:
+            printf(" %d", yylval.dt);
+            break;
+    }
+    printf("\n");
+}
+
+/* scans the file once, returns the number of tokens */
+static long scan(const char *name, int print) {
+    FILE *f = fopen(name, "r");
+    long tokens = 0;
+    int token;
+
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    yyset_in(f, scanner);
+    map_input(f, scanner);
+    yyset_lineno(1, scanner);
+    while ((token = yylex(&yylval, scanner))) {
+        if (print) print_token(token);
+        tokens++;
+    }
+    unmap_input(scanner);
+    fclose(f);
+    return tokens;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 10;
+
+    synthax_ctx_use(synthax_ctx_new());
+    scanner = ctx->scanner;
+
+    if (argc > 1 && !strcmp(argv[1], "-t")) {
+        for (int i = 2; i < argc; i++) scan(argv[i], 1);
+        return 0;
+    }
+    if (argc > 2 && !strcmp(argv[1], "-n")) {
+        repeat = atoi(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s [-t | -n repeat] script ...\n", argv[0]);
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "r");
+        struct timespec start, stop;
+        double mb, seconds;
+        long tokens = 0;
+
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        mb = ftell(f) / 1e6;
+        fclose(f);
+
+        scan(argv[i], 0);  /* the names are interned */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int r = 0; r < repeat; r++) tokens += scan(argv[i], 0);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%s %s: %.1f MB, %ld tokens, %.1f MB/s\n", SCANNER, argv[i], mb,
+               tokens / repeat, mb * repeat / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,459 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <pthread.h>
+# include "helper.h"
+
+/* Lists are persistent: the elements live in a balanced binary tree (AVL)
+   whose leaves hold up to LEAF_SIZE values. Nodes are never changed once
+   built, so the lists made from a list by '+' share its nodes and only
+   copy the O(log n) nodes on the path to the place where they differ.
+   Concatenation joins two trees, append and prepend join a one element
+   leaf, get walks down from the root: all O(log n).
+
+   Elements added to the end of a list by list_push() go to a buffer owned
+   by the list (values), which is turned into leaves (frozen) the first time
+   the list is shared. This keeps building a list and x = x + e on a list
+   only x holds at amortized O(1), as before.
+
+   Lists and nodes count their owners, and are freed with the last one: a
+   list is owned by the variables, elements and values holding it, a node
+   by the lists and nodes pointing to it. The functions building nodes take
+   over the references to the nodes they are given, and a leaf owns its
+   elements.
+
+   The threads of a parallel loop (see parallel.c) read the lists they
+   share at the same time: while the values of their context are shared
+   (see share_values()), references are counted with atomic operations and
+   freezing a list is done under a lock.
+   The new tree is published before the buffer is emptied, and a reader
+   takes the elements after the tree it sees from the buffer, which is
+   left in place, so it finds each element once either way. The tree it
+   replaces may still be read, it is kept until unshare_values(). */
+
+#define LEAF_SIZE 32
+
+struct lnode {
+    int refs;
+    int size;                   /* elements below this node */
+    int height;                 /* 0 for a leaf */
+    struct lnode *left, *right; /* inner nodes */
+    val_t values[];             /* leaves */
+};
+
+static void *list_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    return p;
+}
+
+static void node_retain(struct lnode *node) {
+    if (values_shared())
+        __atomic_add_fetch(&node->refs, 1, __ATOMIC_RELAXED);
+    else
+        node->refs++;
+}
+
+static void node_release(struct lnode *node) {
+    if (!node) return;
+    if (values_shared() ? __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) != 0 : --node->refs != 0)
+        return;
+    if (node->height) {
+        node_release(node->left);
+        node_release(node->right);
+    } else {
+        for (int i = 0; i < node->size; i++) drop_value(node->values[i]);
+    }
+    free(node);
+}
+
+/* the children of an inner node, which is given up for them */
+static void split_node(struct lnode *node, struct lnode **l, struct lnode **r) {
+    *l = node->left;
+    *r = node->right;
+    node_retain(*l);
+    node_retain(*r);
+    node_release(node);
+}
+
+/* leaf with room for n values, the first count copied from values */
+static struct lnode *leaf(val_t *values, int count, int n) {
+    struct lnode *node = list_alloc(sizeof(struct lnode) + n * sizeof(val_t));
+    node->refs = 1;
+    node->size = n;
+    node->height = 0;
+    node->left = node->right = NULL;
+    memcpy(node->values, values, count * sizeof(val_t));
+    return node;
+}
+
+static struct lnode *inner(struct lnode *l, struct lnode *r) {
+    struct lnode *node = list_alloc(sizeof(struct lnode));
+    node->refs = 1;
+    node->size = l->size + r->size;
+    node->height = 1 + (l->height > r->height ? l->height : r->height);
+    node->left = l;
+    node->right = r;
+    return node;
+}
+
+/* inner node of l and r, rotated when their heights differ by two */
+static struct lnode *balance(struct lnode *l, struct lnode *r) {
+    struct lnode *a, *b, *c, *d;
+
+    if (l->height > r->height + 1) {
+        split_node(l, &a, &b);
+        if (a->height >= b->height) {
+            return inner(a, inner(b, r));
+        }
+        split_node(b, &c, &d);
+        return inner(inner(a, c), inner(d, r));
+    }
+    if (r->height > l->height + 1) {
+        split_node(r, &a, &b);
+        if (b->height >= a->height) {
+            return inner(inner(l, a), b);
+        }
+        split_node(a, &c, &d);
+        return inner(inner(l, c), inner(d, b));
+    }
+    return inner(l, r);
+}
+
+/* tree with the elements of a followed by the ones of b. A leaf joined to a
+   tree goes down to the leaf at its side, to be merged with it when they
+   fit together, so that adding elements one at a time fills the leaves */
+static struct lnode *join(struct lnode *a, struct lnode *b) {
+    struct lnode *l, *r;
+
+    if (!a) return b;
+    if (!b) return a;
+
+    if (a->height == 0 && b->height == 0) {
+        if (a->size + b->size > LEAF_SIZE) return inner(a, b);
+
+        struct lnode *node = leaf(a->values, a->size, a->size + b->size);
+        memcpy(node->values + a->size, b->values, b->size * sizeof(val_t));
+        /* the elements now have one more leaf holding them */
+        for (int i = 0; i < node->size; i++) node->values[i] = element_of_value(node->values[i]);
+        node_release(a);
+        node_release(b);
+        return node;
+    }
+    if (a->height > b->height + 1 || b->height == 0) {
+        split_node(a, &l, &r);
+        return balance(l, join(r, b));
+    }
+    if (b->height > a->height + 1 || a->height == 0) {
+        split_node(b, &l, &r);
+        return balance(join(a, l), r);
+    }
+    return inner(a, b);
+}
+
+/* balanced tree of the n values, which are moved to it */
+static struct lnode *from_array(val_t *values, int n) {
+    if (n <= LEAF_SIZE) return leaf(values, n, n);
+
+    int half = (n + LEAF_SIZE - 1) / LEAF_SIZE / 2 * LEAF_SIZE;
+    return inner(from_array(values, half), from_array(values + half, n - half));
+}
+
+/* trees replaced while the values of a context are shared, under lock */
+struct frozen {
+    pthread_mutex_t lock;
+    struct lnode **trees;
+    int count, size;
+};
+
+static void move_to_tree(struct list *lst) {
+    if (lst->count == 0) return;
+    __atomic_store_n(&lst->root, join(lst->root, from_array(lst->values, lst->count)), __ATOMIC_RELEASE);
+    lst->count = 0;
+}
+
+/* move the elements of the buffer to the tree, before sharing its nodes */
+static void freeze(struct list *lst) {
+    if (!lst) return;
+    if (values_shared()) {
+        struct frozen *f = ctx->frozen;
+
+        pthread_mutex_lock(&f->lock);
+        if (lst->count && lst->root) { /* another thread may be reading it */
+            if (f->count == f->size) {
+                f->size = f->size ? 2 * f->size : 16;
+                f->trees = realloc(f->trees, f->size * sizeof(struct lnode *));
+                if (!f->trees) {
+                    yyerror("Out of memory");
+                    exit(1);
+                }
+            }
+            node_retain(lst->root);
+            f->trees[f->count++] = lst->root;
+        }
+        move_to_tree(lst);
+        pthread_mutex_unlock(&f->lock);
+    } else {
+        move_to_tree(lst);
+    }
+}
+
+/* the values of the context are used by the threads of the pool from now
+   on, and by the contexts sharing it (see synthax_ctx_share()) */
+void share_values() {
+    ctx->frozen = list_alloc(sizeof(struct frozen));
+    pthread_mutex_init(&ctx->frozen->lock, NULL);
+    ctx->frozen->trees = NULL;
+    ctx->frozen->count = ctx->frozen->size = 0;
+    __atomic_store_n(&ctx->values_shared, 1, __ATOMIC_RELAXED);
+}
+
+/* the threads are done with them: the trees freeze() kept go */
+void unshare_values() {
+    struct frozen *f = ctx->frozen;
+
+    __atomic_store_n(&ctx->values_shared, 0, __ATOMIC_RELAXED);
+    while (f->count > 0) node_release(f->trees[--f->count]);
+    pthread_mutex_destroy(&f->lock);
+    free(f->trees);
+    free(f);
+    ctx->frozen = NULL;
+}
+
+/* the tree of a list another thread may be freezing */
+static struct lnode *root_of(struct list *lst) {
+    return __atomic_load_n(&lst->root, __ATOMIC_ACQUIRE);
+}
+
+/* Returns the size of a list */
+int list_length(struct list *head) {
+    return head ? head->length : 0;
+}
+
+/* Access a particular element of the list */
+val_t *get(struct list *head, int index) {
+    if (!head || index < 0 || index >= head->length) {
+        return NULL;  // Return null if value is out of bounds
+    }
+    struct lnode *node = root_of(head);
+    if (!node) return &head->values[index];
+    if (index >= node->size) return &head->values[index - node->size];
+
+    while (node->height) {
+        if (index < node->left->size) {
+            node = node->left;
+        } else {
+            index -= node->left->size;
+            node = node->right;
+        }
+    }
+    return &node->values[index];
+}
+
+static void visit(struct lnode *node, void (*fn)(val_t *, void *), void *ctx) {
+    while (node->height) {
+        visit(node->left, fn, ctx);
+        node = node->right;
+    }
+    for (int i = 0; i < node->size; i++) fn(&node->values[i], ctx);
+}
+
+/* visit() of the elements first to end - 1 of the node */
+static void visit_range(struct lnode *node, int first, int end, void (*fn)(val_t *, void *), void *ctx) {
+    while (node->height && first < end) {
+        int left = node->left->size;
+
+        if (end <= left) {
+            node = node->left;
+            continue;
+        }
+        if (first < left) {
+            visit_range(node->left, first, left, fn, ctx);
+            first = 0;
+        } else {
+            first -= left;
+        }
+        end -= left;
+        node = node->right;
+    }
+    for (int i = first; i < end; i++) fn(&node->values[i], ctx);
+}
+
+/* Call fn on each element of the list, in order */
+void list_foreach(struct list *lst, void (*fn)(val_t *, void *), void *ctx) {
+    if (!lst) return;
+    struct lnode *root = root_of(lst);
+    int frozen = root ? root->size : 0;
+    if (root) visit(root, fn, ctx);
+    for (int i = 0; i < lst->length - frozen; i++) fn(&lst->values[i], ctx);
+}
+
+/* Same for the elements at indexes first to end - 1, in O(log n) more */
+void list_foreach_range(struct list *lst, int first, int end, void (*fn)(val_t *, void *), void *ctx) {
+    if (!lst) return;
+    struct lnode *root = root_of(lst);
+    int frozen = root ? root->size : 0;
+    if (first < 0) first = 0;
+    if (end > lst->length) end = lst->length;
+    if (root && first < frozen) visit_range(root, first, end < frozen ? end : frozen, fn, ctx);
+    for (int i = first > frozen ? first : frozen; i < end; i++) fn(&lst->values[i - frozen], ctx);
+}
+
+/* Create an empty list with room for capacity elements */
+struct list *new_list(int capacity) {
+    struct list *lst = list_alloc(sizeof(struct list));
+
+    lst->root = NULL;
+    lst->length = 0;
+    lst->count = 0;
+    lst->front = 0;
+    lst->refs = 1; /* the caller's */
+    lst->capacity = capacity > 0 ? capacity : 4;
+    lst->values = list_alloc(lst->capacity * sizeof(val_t));
+    return lst;
+}
+
+/* Add a value at the end of a list being built */
+void list_push(struct list *lst, val_t v) {
+    if (lst->front + lst->count == lst->capacity) {
+        lst->capacity *= 2;
+        val_t *base = realloc(lst->values - lst->front, lst->capacity * sizeof(val_t));
+        if (!base) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+        lst->values = base + lst->front;
+    }
+    lst->values[lst->count++] = v;
+    lst->length++;
+}
+
+/* Add a value at the beginning of a list. Without a tree, the room left in
+   front of the buffer doubles each time it runs out */
+static void list_unshift(struct list *lst, val_t v) {
+    if (lst->root) {
+        lst->root = join(leaf(&v, 1, 1), lst->root);
+        lst->length++;
+        return;
+    }
+    if (lst->front == 0) {
+        int front = lst->capacity;
+        val_t *base = list_alloc(2 * lst->capacity * sizeof(val_t));
+        memcpy(base + front, lst->values, lst->count * sizeof(val_t));
+        free(lst->values);
+        lst->values = base + front;
+        lst->front = front;
+        lst->capacity *= 2;
+    }
+    lst->front--;
+    *--lst->values = v;
+    lst->count++;
+    lst->length++;
+}
+
+/* A variable, an element or a value keeps a reference to lst */
+void list_retain(struct list *lst) {
+    if (!lst) return;
+    if (values_shared())
+        __atomic_add_fetch(&lst->refs, 1, __ATOMIC_RELAXED);
+    else
+        lst->refs++;
+}
+
+static void list_free(struct list *lst) {
+    node_release(lst->root);
+    for (int i = 0; i < lst->count; i++) drop_value(lst->values[i]);
+    free(lst->values - lst->front);
+    free(lst);
+}
+
+/* A holder of lst gives up its reference, the last one frees it */
+void list_release(struct list *lst) {
+    if (!lst) return;
+    if (values_shared() ? __atomic_sub_fetch(&lst->refs, 1, __ATOMIC_ACQ_REL) == 0 : --lst->refs == 0)
+        list_free(lst);
+}
+
+/* x = x + v (front = 0) or x = v + x (front = 1) where sym is x and lst the
+   value x had, which the caller holds: when x is its only other holder,
+   the elements are added to it instead of making a new list. elems are the
+   elements of v when it is not a list, NULL to add v itself. Returns 0 if
+   it cannot be done */
+int list_add_in_place(struct symbol *sym, struct list *lst, val_t v, struct list *elems, int front) {
+    if (!lst || sym->type != 3 || sym->list != lst
+        || (values_shared() ? __atomic_load_n(&lst->refs, __ATOMIC_RELAXED) : lst->refs) != 2) return 0;
+
+    if (v.type == 3) {
+        elems = v.data.list;
+        if (elems == lst) return 0;
+    } else if (!elems) {
+        if (front) list_unshift(lst, element_of_value(v));
+        else list_push(lst, element_of_value(v));
+        return 1;
+    }
+
+    int n = list_length(elems);
+    if (n > LEAF_SIZE) { /* share the nodes of elems */
+        freeze(elems);
+        node_retain(elems->root);
+        if (front) {
+            lst->root = join(elems->root, lst->root);
+        } else {
+            freeze(lst);
+            lst->root = join(lst->root, elems->root);
+        }
+        lst->length += n;
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        val_t e = element_of_value(*get(elems, front ? n - 1 - i : i));
+        if (front) list_unshift(lst, e);
+        else list_push(lst, e);
+    }
+    return 1;
+}
+
+/* Copy of v to be kept as an element of a list */
+val_t element_of_value(val_t v) {
+    if (v.type == 2) {
+        string_retain(v.data.string);
+        return (val_t){.type = 2, .data.string = v.data.string};
+    } else if (v.type == 3) {
+        list_retain(v.data.list);
+        return (val_t){.type = 3, .data.list = v.data.list};
+    }
+    return (val_t){.type = 1, .data.number = v.data.number};
+}
+
+/* Give back the string or the list of a value that is not kept */
+void drop_value(val_t v) {
+    if (v.type == 2) string_release(v.data.string);
+    else if (v.type == 3) list_release(v.data.list);
+}
+
+/* Create a one element list holding a copy of v */
+struct list *list_of_value(val_t v) {
+    struct list *lst = new_list(1);
+
+    list_push(lst, element_of_value(v));
+    return lst;
+}
+
+/* New list with the elements of l1 followed by the ones of l2, sharing
+   their nodes: the operands are left unchanged */
+struct list *concat_lists(struct list *l1, struct list *l2) {
+    int n1 = list_length(l1), n2 = list_length(l2);
+
+    if (n1 + n2 == 0) return NULL;
+    freeze(l1);
+    freeze(l2);
+    if (n1) node_retain(l1->root);
+    if (n2) node_retain(l2->root);
+    struct list *lst = new_list(0);
+    lst->root = join(n1 ? l1->root : NULL, n2 ? l2->root : NULL);
+    lst->length = n1 + n2;
+    return lst;
+}
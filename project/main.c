@@ -0,0 +1,266 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <pthread.h>
+# include <unistd.h>
+# include <sys/wait.h>
+# include "helper.h"
+
+/* The synthax command: runs the scripts given to it, or stdin. Everything
+   else is in the library, see synthax.h */
+
+/* --cache: a script that is not streamed is taken from the cache of
+   parsed scripts when it is there, see cache.c */
+static void run(FILE *f, int stream, int cache) {
+    if(cache && !stream)
+        run_cached(f);
+    else
+        run_file(f, stream);
+}
+
+/* --threads: each script runs on a thread of its own, in a context of its
+   own, instead of one after the other in the same context */
+struct script {
+    pthread_t thread;
+    const char *path;
+    enum engine engine;
+    int stream;
+    int cache;
+    int status;
+};
+
+/* an error that stops the script returns here, the other scripts go on */
+static void *run_script(void *arg) {
+    struct script *sc = arg;
+    FILE *f = fopen(sc->path, "r");
+    jmp_buf stop;
+
+    if(!f) {
+        perror(sc->path);
+        sc->status = 1;
+        return NULL;
+    }
+    synthax_ctx_use(synthax_ctx_new());
+    ctx->engine = sc->engine;
+    ctx->stop = &stop;
+    if(setjmp(stop)) {
+        sc->status = 1; /* an error stopped the script */
+    } else {
+        run(f, sc->stream, sc->cache);
+    }
+    fclose(f);
+    synthax_ctx_free(ctx);
+    return NULL;
+}
+
+static int run_threads(char **paths, int n, enum engine engine, int stream, int cache) {
+    struct script *scripts = calloc(n, sizeof(struct script));
+    pthread_attr_t attr;
+    int status = 0;
+
+    if(!scripts) {
+        fprintf(stderr, "Error in memory: impossible to start the scripts.\n");
+        return 1;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, thread_stack_size()); /* the room run_call() counts on */
+    for(int i = 0; i < n; i++) {
+        scripts[i].path = paths[i];
+        scripts[i].engine = engine;
+        scripts[i].stream = stream;
+        scripts[i].cache = cache;
+        if(pthread_create(&scripts[i].thread, &attr, run_script, &scripts[i])) {
+            fprintf(stderr, "%s: impossible to start a thread\n", paths[i]);
+            scripts[i].status = 1;
+            scripts[i].path = NULL;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    for(int i = 0; i < n; i++) {
+        if(scripts[i].path) pthread_join(scripts[i].thread, NULL);
+        status |= scripts[i].status;
+    }
+    free(scripts);
+    return status;
+}
+
+/* -j N: the scripts run in processes of their own, N at a time. What a
+   script prints is kept in a file until the scripts before it have been
+   written, so the output comes in the order of the scripts whatever the
+   order they end in, then a summary of the ones that failed */
+struct job {
+    pid_t pid;
+    FILE *out;      /* stdout and stderr of the script while it runs */
+    char *text;     /* then what it printed, read from out */
+    long length;
+    int status;     /* of waitpid() */
+    int done;
+};
+
+static pid_t start_job(struct script *sc, FILE *out) {
+    pid_t pid;
+
+    fflush(stdout);  /* or the child would write it again */
+    fflush(stderr);
+    if((pid = fork()) != 0)
+        return pid;
+    dup2(fileno(out), 1);
+    dup2(fileno(out), 2);
+    run_script(sc);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(sc->status);
+}
+
+/* the job has ended: its output is kept in memory, so that only the
+   jobs running hold a file */
+static void end_job(struct job *j, int status) {
+    j->status = status;
+    j->done = 1;
+    if(!j->out) return;
+    fseek(j->out, 0, SEEK_END);
+    j->length = ftell(j->out);
+    rewind(j->out);
+    if(j->length > 0 && (j->text = malloc(j->length)))
+        j->length = fread(j->text, 1, j->length, j->out);
+    else
+        j->length = 0;
+    fclose(j->out);
+    j->out = NULL;
+}
+
+/* writes the output of a job that has ended, 1 when it failed */
+static int write_job(struct job *j, const char *path) {
+    fwrite(j->text, 1, j->length, stdout);
+    fflush(stdout);
+    free(j->text);
+    if(WIFSIGNALED(j->status)) {
+        fprintf(stderr, "%s: killed by signal %d\n", path, WTERMSIG(j->status));
+        return 1;
+    }
+    if(WEXITSTATUS(j->status)) {
+        fprintf(stderr, "%s: stopped by an error\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+static int run_batch(char **paths, int n, int workers, enum engine engine, int stream, int cache) {
+    struct job *jobs = calloc(n, sizeof(struct job));
+    struct script sc = { .engine = engine, .stream = stream, .cache = cache };
+    int started = 0, written = 0, running = 0, failed = 0;
+
+    if(!jobs) {
+        fprintf(stderr, "Error in memory: impossible to start the scripts.\n");
+        return 1;
+    }
+    while(written < n) {
+        pid_t pid;
+        int status;
+
+        for(; running < workers && started < n; started++) {
+            struct job *j = &jobs[started];
+
+            sc.path = paths[started];
+            if(!(j->out = tmpfile()) || (j->pid = start_job(&sc, j->out)) < 0) {
+                perror(paths[started]);
+                end_job(j, 1 << 8);  /* as exit(1) */
+            } else {
+                running++;
+            }
+        }
+        if(running > 0 && (pid = wait(&status)) > 0) {
+            running--;
+            for(int i = written; i < started; i++) {
+                if(jobs[i].pid == pid && !jobs[i].done) end_job(&jobs[i], status);
+            }
+        }
+        for(; written < started && jobs[written].done; written++)
+            failed += write_job(&jobs[written], paths[written]);
+    }
+    fprintf(stderr, "%d scripts run, %d failed\n", n, failed);
+    free(jobs);
+    return failed > 0;
+}
+
+int main(int argc, char **argv) {
+    int nfiles = 0;
+    int stream = 0;
+    int threads = 0;
+    int workers = 0;
+    int cache = 0;
+    const char *socket_path = NULL;
+    const char *zygote_path = NULL;
+    enum engine engine = ENGINE_TREE;
+
+#ifdef ALLOC_DEBUG
+    atexit(alloc_report);
+#endif
+    /* options come before the scripts */
+    while(argc > 1 && argv[1][0] == '-') {
+        if(!strcmp(argv[1], "--engine=vm")) {
+            engine = ENGINE_VM;
+        } else if(!strcmp(argv[1], "--engine=tree")) {
+            engine = ENGINE_TREE;
+        } else if(!strcmp(argv[1], "--stream")) {
+            stream = 1;
+        } else if(!strcmp(argv[1], "--threads")) {
+            threads = 1;
+        } else if(!strcmp(argv[1], "-j") && argc > 2 && atoi(argv[2]) > 0) {
+            workers = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else if(!strncmp(argv[1], "-j", 2) && atoi(argv[1] + 2) > 0) {
+            workers = atoi(argv[1] + 2);
+        } else if(!strcmp(argv[1], "--cache")) {
+            cache = 1;
+        } else if(!strcmp(argv[1], "--serve") && argc > 2) {
+            socket_path = argv[2];
+            argv++;
+            argc--;
+        } else if(!strcmp(argv[1], "--zygote") && argc > 2) {
+            zygote_path = argv[2];
+            argv++;
+            argc--;
+        } else {
+            fprintf(stderr, "usage: %s [--engine=vm|tree] [--stream] [--threads] [-j N] [--cache] [--serve socket] [--zygote socket] [script ...]\n", argv[0]);
+            return (1);
+        }
+        argv++;
+        argc--;
+    }
+    nfiles = argc - 1;
+
+    if(socket_path)
+        return serve(socket_path, engine);
+
+    if(workers && nfiles > 0 && !zygote_path)
+        return run_batch(argv + 1, nfiles, workers, engine, stream, cache);
+
+    if(threads && nfiles > 0 && !zygote_path)
+        return run_threads(argv + 1, nfiles, engine, stream, cache);
+
+    /* the scripts run one after the other in the same context, each sees
+       the variables of the ones before */
+    synthax_ctx_use(synthax_ctx_new());
+    ctx->engine = engine;
+    if(nfiles < 1 && !zygote_path) { /* just read stdin */
+        run_file(stdin, stream);
+        synthax_ctx_free(ctx);
+        return 0;
+    }
+    for(int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "r");
+        if(!f) {
+            perror(argv[i]);
+            return (1);
+        }
+        run(f, stream, cache);
+        fclose(f);
+    }
+    /* the jobs see what the scripts, its libraries, left */
+    if(zygote_path)
+        return zygote(zygote_path);
+    synthax_ctx_free(ctx);
+    return 0;
+}
@@ -0,0 +1,1119 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <stdint.h>
+# include <math.h>
+# include <unistd.h>
+# include <pthread.h>
+# include <sched.h>
+# include "helper.h"
+
+/* from parallel: the iterations of a 'P' loop run on the threads of a
+   pool, each in a context of its own (see synthax_ctx_share()) that sees
+   the variables of the script and has its own copy of the loop variable
+   and of the variables declared in the body.
+
+       from parallel [num i = 0 to n !> 1] [s +, m max] { ... }
+
+   The reductions after the bounds are the only variables around the loop
+   the body may change: each thread starts them again from 0, an empty
+   string or list (s +) or from their value before the loop (m min, m max)
+   for each block of iterations it runs, and what the blocks leave is
+   added to the variable in the order of the blocks, so that a list or a
+   string comes out as the serial loop would build it. That only holds
+   when the body, and the functions it calls, use s in s = s + e alone, e
+   not reading s, and m in whether [e > m] then: { m = e; } alone, or
+   with <, >= or <= in the way of the reduction.
+
+   A loop that could see the difference runs as the 'T' it is instead:
+   when its body, or a function it calls, uses a reduction another way,
+   changes another variable around the loop or the loop variable, prints,
+   reads the input or gives back, when its bounds call a function, when
+   the step is not a positive integer and the start an integer, or when
+   the pool is busy, with another loop or with the loop around this one. The bounds and the step
+   are evaluated once, before the iterations, which is the same when the
+   body changes none of them.
+
+   map(l, f) and filter(l, f) call f on the elements of the list l in
+   blocks run by the threads the same way, each block building its part
+   of the result, and the parts are put together in the order of the
+   blocks. A short list, a function that could not run on threads, as
+   above, or a pool busy with another job make the calling thread do the
+   whole list. reduce(l, f, init) always folds l from init in the order
+   of the elements: nothing tells that f can be applied in another order.
+
+   spawn f(args) makes a task of the call and gives its number, which
+   await(t) turns into the value f gave back. A task runs when a thread
+   waits on an await: the one of the script and, while it waits, the
+   threads of the pool, each taking the tasks it spawned last from the
+   back of its own deque, and the ones spawned first from the front of
+   the deque of another thread when its own is empty. A thread waiting
+   on a task does not stop: it runs other tasks on top of its stack until
+   the one it waits on is done, so a task only awaits the tasks it
+   spawned, which started after it. Awaiting a task again gives the same
+   value. A function that reads or changes a variable of the script, or
+   prints or reads the input, would show when it runs: spawn calls it at
+   once instead. */
+
+/* The iterations are cut in up to LOOP_BLOCKS blocks whatever the number
+   of threads, which take the next block as they finish one: a sum of
+   numbers comes out the same on any machine */
+#define LOOP_BLOCKS 256
+#define MAX_THREADS 64
+
+/* Lists shorter than APPLY_SERIAL are done by the calling thread, longer
+   ones cut in blocks of at least APPLY_BLOCK elements */
+#define APPLY_SERIAL 256
+#define APPLY_BLOCK 64
+
+/* Threads of the pool, started at the first parallel loop, wait for the
+   next loop from then on. The thread running a loop takes part in it, and
+   holds busy meanwhile */
+static struct {
+    pthread_mutex_t busy;
+    pthread_mutex_t lock;       /* for the rest */
+    pthread_cond_t start, done;
+    int started;
+    int size;                   /* threads of a loop, the caller included */
+    unsigned generation;        /* of the last job started */
+    int running;                /* threads of the pool still on it */
+    void (*job)(void *arg, int id);
+    void *arg;
+} pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER
+};
+
+static void *pool_thread(void *arg) {
+    int id = (intptr_t)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen) pthread_cond_wait(&pool.start, &pool.lock);
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+        pool.job(pool.arg, id);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.running == 0) pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+/* a process forked by --zygote or -j has none of the threads */
+static void forget_pool() {
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_mutex_init(&pool.busy, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    pool.started = 0;
+    pool.generation = 0;
+    pool.running = 0;
+}
+
+static void on_fork() {
+    pthread_atfork(NULL, NULL, forget_pool);
+}
+
+/* threads of a loop, SYNTHAX_THREADS or one for each processor */
+static int pool_size() {
+    static pthread_once_t registered = PTHREAD_ONCE_INIT;
+
+    pthread_once(&registered, on_fork);
+    pthread_mutex_lock(&pool.lock);
+    if (!pool.started) {
+        const char *env = getenv("SYNTHAX_THREADS");
+        long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+        pthread_attr_t attr;
+
+        if (n > MAX_THREADS) n = MAX_THREADS;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, thread_stack_size());
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pool.started = 1;
+        for (pool.size = 1; pool.size < n; pool.size++) {
+            pthread_t thread;
+
+            if (pthread_create(&thread, &attr, pool_thread, (void *)(intptr_t)pool.size)) break;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return pool.size;
+}
+
+/* job(arg, id) on every thread of the pool, id 0 being the calling one */
+static void run_on_pool(void (*job)(void *, int), void *arg) {
+    pthread_mutex_lock(&pool.lock);
+    pool.job = job;
+    pool.arg = arg;
+    pool.running = pool.size - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    job(arg, 0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running) pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+/* Work stealing: the blocks of a job are dealt in one range of blocks
+   for each thread, which takes the blocks of its range from the front.
+   A thread that has run out takes the back half of what is left in the
+   range of the next thread that has some, so the threads keep working
+   while there are blocks left without all waiting on the same counter */
+struct range {
+    pthread_mutex_t lock;
+    int next, end;
+};
+
+static void deal_blocks(struct range *ranges, int nblocks) {
+    for (int t = 0; t < pool.size; t++) {
+        pthread_mutex_init(&ranges[t].lock, NULL);
+        ranges[t].next = nblocks * t / pool.size;
+        ranges[t].end = nblocks * (t + 1) / pool.size;
+    }
+}
+
+static void free_ranges(struct range *ranges) {
+    for (int t = 0; t < pool.size; t++) pthread_mutex_destroy(&ranges[t].lock);
+}
+
+/* block thread id runs next, -1 when none are left */
+static int next_block(struct range *ranges, int id) {
+    struct range *own = &ranges[id];
+    int b = -1;
+
+    pthread_mutex_lock(&own->lock);
+    if (own->next < own->end) b = own->next++;
+    pthread_mutex_unlock(&own->lock);
+    for (int k = 1; b < 0 && k < pool.size; k++) {
+        struct range *victim = &ranges[(id + k) % pool.size];
+        int first = -1, end = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            end = victim->end;
+            first = victim->end = end - (end - victim->next + 1) / 2;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (first >= 0) {
+            pthread_mutex_lock(&own->lock);
+            own->next = first + 1;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            b = first;
+        }
+    }
+    return b;
+}
+
+/* an error stopped a thread of the job, and has been reported */
+static void stop_script() {
+    if (ctx->stop) longjmp(*ctx->stop, 1);
+    exit(1);
+}
+
+struct reduction {
+    int op;                 /* '+', '1' for max or '2' for min */
+    struct symbol *sym;     /* the variable, in the scopes of the script */
+    int level;              /* the scope it is in */
+    double initial;         /* its value before the loop, for min and max */
+};
+
+struct loop {
+    struct ast *a;
+    struct synthax_ctx *parent;     /* context of the script */
+    struct bytecode *code;          /* body for the vm, NULL for eval() */
+    double start, step;
+    long count;                     /* iterations */
+    int nblocks;
+    struct range ranges[MAX_THREADS];
+    int failed;                     /* an error stopped a thread */
+    struct reduction *red;
+    int nred;
+    val_t *partial;                 /* of each reduction after each block */
+    struct ast **seen;              /* bodies of the functions checked */
+    int nseen;
+    int task;                       /* checking the function of a spawn */
+};
+
+/* an expression that can be evaluated once more, or not at all, without
+   anyone seeing it */
+static int pure(struct ast *a) {
+    if (!a) return 1;
+    if (a->nodetype == 'C' || a->nodetype == 'A') return 0;
+    if (a->nodetype == 'F' && (a->data.functype == B_print || a->data.functype == B_input ||
+                               a->data.functype == B_casual || a->data.functype >= B_map))
+        return 0;
+    return pure(a->l) && pure(a->r);
+}
+
+static int numeric(int type) {
+    return type == 1 || type == 6 || type == 7;
+}
+
+static int is_reduction(struct loop *lp, char *name) {
+    for (int r = 0; r < lp->nred; r++) {
+        if (lp->red[r].sym->name == name) return 1;
+    }
+    return 0;
+}
+
+/* the reduction a variable or an assignment of the statements of a loop
+   at nest (see safe()) names, NULL for a variable of their own */
+static struct reduction *reduction_of(struct loop *lp, struct ast *a, int nest) {
+    if (a->depth >= 0 && (!nest || a->depth < nest)) return NULL;
+    for (int r = 0; r < lp->nred; r++) {
+        if (lp->red[r].sym->name == a->data.sym->name) return &lp->red[r];
+    }
+    return NULL;
+}
+
+static int is_variable(struct loop *lp, struct ast *a, struct reduction *red, int nest) {
+    return a && a->nodetype == 'N' && reduction_of(lp, a, nest) == red;
+}
+
+/* two expressions that give the same value */
+static int same(struct ast *a, struct ast *b) {
+    if (!a || !b) return a == b;
+    if (a->nodetype != b->nodetype) return 0;
+    switch (a->nodetype) {
+        case 'K':
+            if (a->data.number != b->data.number) return 0;
+            break;
+        case 'S':
+            if (strcmp(a->data.s, b->data.s)) return 0;
+            break;
+        case 'N':
+            if (a->data.sym->name != b->data.sym->name || a->depth != b->depth || a->slot != b->slot)
+                return 0;
+            break;
+        case 'F':
+            if (a->data.functype != b->data.functype) return 0;
+            break;
+        case 'I': case 'W': case 'T': case 'P': case 'C': case 'A': case '=': case 'D':
+            return 0;
+    }
+    return same(a->l, b->l) && same(a->r, b->r);
+}
+
+/* whether [e > m] then: { m = e; } for m max, or with < for m min: the
+   only change of a min or a max a block can leave for the others */
+static struct reduction *guarded(struct loop *lp, struct ast *a, int nest) {
+    struct ast *cmp = a->data.flow.cond, *set = a->data.flow.tl, *e;
+    struct reduction *red;
+    int greater;
+
+    if (!set || set->nodetype != '=' || !(red = reduction_of(lp, set, nest)) || red->op == '+')
+        return NULL;
+    if (cmp->nodetype != '1' && cmp->nodetype != '2' && cmp->nodetype != '5' && cmp->nodetype != '6')
+        return NULL;
+    greater = cmp->nodetype == '1' || cmp->nodetype == '5';
+    if (is_variable(lp, cmp->r, red, nest)) {
+        e = cmp->l;
+    } else if (is_variable(lp, cmp->l, red, nest)) {
+        e = cmp->r;
+        greater = !greater;
+    } else {
+        return NULL;
+    }
+    if (greater != (red->op == '1') || !pure(e) || !same(e, set->l)) return NULL;
+    return red;
+}
+
+static int safe(struct loop *lp, struct ast *a, int nest);
+
+/* a function the body calls, each is checked once. A loop with no body
+   nor reductions checks the function of map, filter or reduce */
+static int safe_call(struct loop *lp, struct symbol *fn) {
+    if (!fn || !fn->func) return 0;
+    for (int i = 0; i < lp->nseen; i++) {
+        if (lp->seen[i] == fn->func) return 1;
+    }
+    if (!(lp->nseen & (lp->nseen - 1))) {
+        lp->seen = realloc(lp->seen, (lp->nseen ? 2 * lp->nseen : 1) * sizeof(struct ast *));
+        if (!lp->seen) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+    }
+    lp->seen[lp->nseen++] = fn->func;
+    /* the vm compiles a function at its first call, before the threads do */
+    if (ctx->engine == ENGINE_VM && !fn->code) fn->code = compile_function(fn);
+    return safe(lp, fn->func, 0);
+}
+
+/* can the statements of a run on several threads at once. nest is the
+   number of scopes of the loop around a, 0 in the body of a function,
+   where only the variables of the function are its own */
+static int safe(struct loop *lp, struct ast *a, int nest) {
+    int inner = nest ? nest + 1 : 0;
+
+    if (!a) return 1;
+    switch (a->nodetype) {
+        case 'K': case 'S': case 'D':
+            return 1;
+        case 'N': /* a task sees the variables of its function only, a block
+                     sees a reduction from where it started it */
+            return (!lp->task || a->depth >= 0) && !reduction_of(lp, a, nest);
+        case 'R': /* leaves the function, or stops the script */
+            return nest == 0 && safe(lp, a->l, nest);
+        case '=': { /* lp->a->l->l declares the loop variable */
+            struct reduction *red;
+
+            if (nest && a->depth == nest - 1 && a->slot == lp->a->l->l->slot) return 0;
+            if (a->depth >= 0 && (!nest || a->depth < nest)) return safe(lp, a->l, nest);
+            /* x = x + e for x +, e without x. A min or a max is only
+               changed in guarded() */
+            red = reduction_of(lp, a, nest);
+            if (!red || red->op != '+' || !a->l || a->l->nodetype != '+' ||
+                !is_variable(lp, a->l->l, red, nest))
+                return 0;
+            return safe(lp, a->l->r, nest);
+        }
+        case 'F':
+            if (a->data.functype == B_print || a->data.functype == B_input) return 0;
+            if (a->data.functype == B_await && !lp->task) return 0;
+            if (a->data.functype == B_map || a->data.functype == B_filter ||
+                a->data.functype == B_reduce) { /* the 'N' naming the function is no variable */
+                struct ast *f = a->l->r->nodetype == '[' ? a->l->r->l : a->l->r;
+                return safe_call(lp, find_symbol(f->data.sym->name)) && safe(lp, a->l->l, nest) &&
+                       (f == a->l->r || safe(lp, a->l->r->r, nest));
+            }
+            return safe(lp, a->l, nest);
+        case 'C':
+            return safe(lp, a->l, nest) && safe_call(lp, find_symbol(a->data.sym->name));
+        case 'A': /* only tasks spawn, the threads of a loop have nowhere to keep them */
+            return lp->task && safe(lp, a->l->l, nest) &&
+                   safe_call(lp, find_symbol(a->l->data.sym->name));
+        case 'I':
+            if (guarded(lp, a, nest))
+                return safe(lp, a->data.flow.tl->l, nest) && safe(lp, a->data.flow.el, nest);
+            return safe(lp, a->data.flow.cond, nest) && safe(lp, a->data.flow.tl, nest) &&
+                   safe(lp, a->data.flow.el, nest);
+        case 'W': /* el is the condition again for when {} until [] */
+            return safe(lp, a->data.flow.cond, inner) && safe(lp, a->data.flow.tl, inner);
+        case 'T': case 'P':
+            return safe(lp, a->l, inner) && safe(lp, a->data.flow.cond, inner) &&
+                   safe(lp, a->r, inner);
+        default:
+            return safe(lp, a->l, nest) && safe(lp, a->r, nest);
+    }
+}
+
+/* the variables of the reductions, in the scopes of the script */
+static int find_reductions(struct loop *lp) {
+    struct ast *chain = lp->a->data.flow.tl;
+
+    for (struct ast *c = chain; c; c = c->nodetype == '[' ? c->r : NULL) lp->nred++;
+    lp->red = calloc(lp->nred ? lp->nred : 1, sizeof(struct reduction));
+    if (!lp->red) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    lp->nred = 0;
+    for (struct ast *c = chain; c; c = c->nodetype == '[' ? c->r : NULL) {
+        struct ast *n = c->nodetype == '[' ? c->l : c;
+        struct reduction *red = &lp->red[lp->nred];
+        struct symbol *s = slot_at(n->l->depth, n->l->slot);
+
+        if (!s) s = find_symbol(n->l->data.sym->name);
+        if (!s || is_reduction(lp, s->name)) return 0;
+        /* numbers, strings and lists add up, only numbers have a min and a max */
+        if (!numeric(s->type) && (n->nodetype != '+' || (s->type != 2 && s->type != 3)))
+            return 0;
+        red->op = n->nodetype;
+        red->sym = s;
+        red->initial = s->value;
+        for (red->level = ctx->scope_top; red->level >= 0; red->level--) {
+            scope_t *sc = &ctx->scope_stack[red->level];
+            if (s >= sc->symtab && s < sc->symtab + sc->symtab_count) break;
+        }
+        if (red->level < 0) return 0;
+        lp->nred++;
+    }
+    return 1;
+}
+
+/* start, step and number of iterations, when the step is a positive
+   integer and i = start + k * step can be computed for each k */
+static int bounds(struct loop *lp) {
+    struct ast *a = lp->a, *d = a->l->l;
+    struct ast *to = a->data.flow.cond->r, *step = a->r->r->l->r;
+    double limit = 9007199254740992.0; /* 2^53, integers are exact below it */
+    val_t last, by;
+
+    if (!to || !step || !pure(a->l->r->l) || !pure(to) || !pure(step)) return 0;
+    push_scope(a->slot);
+    drop_value(eval(a->l));
+    lp->start = lookup_at(0, d->slot, d->data.sym->name)->value;
+    last = eval(to);
+    by = eval(step);
+    pop_scope();
+    drop_value(last);
+    drop_value(by);
+    if (last.type != 1 || by.type != 1) return 0;
+    lp->step = by.data.number;
+    if (!(lp->step >= 1 && lp->step < limit && fabs(lp->start) < limit && fabs(last.data.number) < limit) ||
+        lp->step != floor(lp->step) || lp->start != floor(lp->start))
+        return 0;
+    if (last.data.number < lp->start) {
+        lp->count = 0;
+    } else {
+        lp->count = (long)floor((last.data.number - lp->start) / lp->step) + 1;
+        while (lp->count > 0 && lp->start + (lp->count - 1) * lp->step > last.data.number) lp->count--;
+        while (lp->start + lp->count * lp->step <= last.data.number) lp->count++;
+    }
+    return 1;
+}
+
+/* the reduction variables of a thread are in copies of the scopes that
+   hold them */
+static void copy_scopes(struct loop *lp, struct symbol **vars) {
+    for (int r = 0; r < lp->nred; r++) {
+        scope_t *sc = &ctx->scope_stack[lp->red[r].level];
+        struct symbol *shared = lp->parent->scope_stack[lp->red[r].level].symtab;
+
+        if (sc->symtab == shared) {
+            sc->symtab = malloc(sc->symtab_size * sizeof(struct symbol));
+            if (!sc->symtab) {
+                yyerror("Out of memory");
+                exit(1);
+            }
+            memcpy(sc->symtab, shared, sc->symtab_count * sizeof(struct symbol));
+        }
+        vars[r] = sc->symtab + (lp->red[r].sym - shared);
+    }
+}
+
+static void free_copies(struct loop *lp) {
+    for (int r = 0; r < lp->nred; r++) {
+        scope_t *sc = &ctx->scope_stack[lp->red[r].level];
+        struct symbol *shared = lp->parent->scope_stack[lp->red[r].level].symtab;
+
+        if (sc->symtab != shared) free(sc->symtab);
+        sc->symtab = shared;
+    }
+}
+
+/* a reduction variable starts a block empty, what it held was taken */
+static void reset(struct reduction *red, struct symbol *s) {
+    if (s->type == 2) {
+        s->string = NULL;
+    } else if (s->type == 3) {
+        s->list = NULL;
+    } else {
+        s->value = red->op == '+' ? 0 : red->initial;
+    }
+}
+
+static val_t take(struct symbol *s) {
+    val_t v = {.type = 1, .data.number = s->value};
+
+    if (s->type == 2) {
+        v = (val_t){.type = 2, .data.string = s->string};
+        s->string = NULL;
+    } else if (s->type == 3) {
+        v = (val_t){.type = 3, .data.list = s->list};
+        s->list = NULL;
+    }
+    return v;
+}
+
+static void run_block(struct loop *lp, int b, struct symbol **vars) {
+    struct ast *d = lp->a->l->l;
+    long first = lp->count * b / lp->nblocks, end = lp->count * (b + 1) / lp->nblocks;
+
+    for (int r = 0; r < lp->nred; r++) reset(&lp->red[r], vars[r]);
+    push_scope(lp->a->slot);
+    declare_symbol(d->slot, d->data.sym);
+    for (long k = first; k < end && !__atomic_load_n(&lp->failed, __ATOMIC_RELAXED); k++) {
+        lookup_at(0, d->slot, d->data.sym->name)->value = lp->start + k * lp->step;
+        if (lp->code)
+            vm_exec(lp->code);
+        else
+            drop_value(eval(lp->a->r->l));
+    }
+    pop_scope();
+    for (int r = 0; r < lp->nred; r++) lp->partial[b * lp->nred + r] = take(vars[r]);
+}
+
+/* what each thread of the pool does: blocks until there are none left,
+   an error that stops the script stops the other threads too */
+static void run_blocks(void *arg, int id) {
+    struct loop *lp = arg;
+    struct synthax_ctx *w = synthax_ctx_share(lp->parent);
+    struct symbol *vars[lp->nred + 1];
+    jmp_buf stop;
+    int b;
+
+    copy_scopes(lp, vars);
+    w->stop = &stop;
+    if (setjmp(stop)) {
+        __atomic_store_n(&lp->failed, 1, __ATOMIC_RELAXED);
+    } else {
+        while (!__atomic_load_n(&lp->failed, __ATOMIC_RELAXED) &&
+               (b = next_block(lp->ranges, id)) >= 0)
+            run_block(lp, b, vars);
+    }
+    while (ctx->scope_top > lp->parent->scope_top) pop_scope();
+    free_copies(lp);
+    synthax_ctx_unshare(w);
+}
+
+/* what the blocks left, in their order */
+static void combine(struct reduction *red, val_t v) {
+    struct symbol *s = red->sym;
+
+    if (s->type == 2) {
+        if (v.data.string) s->string = s->string ? add_strings(s->string, v.data.string) : v.data.string;
+    } else if (s->type == 3) {
+        if (v.data.list) {
+            struct list *lst = concat_lists(s->list, v.data.list);
+            list_release(s->list);
+            list_release(v.data.list);
+            s->list = lst;
+        }
+    } else if (red->op == '+') {
+        s->value += v.data.number;
+    } else if (red->op == '1' ? v.data.number > s->value : v.data.number < s->value) {
+        s->value = v.data.number;
+    }
+}
+
+static void free_loop(struct loop *lp) {
+    free_bytecode(lp->code);
+    free(lp->partial);
+    free(lp->red);
+    free(lp->seen);
+}
+
+/* run the 'P' loop a on the threads, 1 when it did with the value of the
+   loop in v, 0 when it has to run as a 'T' */
+int parallel_for(struct ast *a, val_t *v) {
+    struct loop lp = { .a = a, .parent = ctx };
+
+    if (pool_size() < 2 || !numeric(a->l->l->data.sym->type) || !find_reductions(&lp) ||
+            !safe(&lp, a->r->l, 1) || !bounds(&lp) || lp.count < 2 ||
+            pthread_mutex_trylock(&pool.busy)) {
+        free_loop(&lp);
+        return 0;
+    }
+    if (ctx->engine == ENGINE_VM) lp.code = compile_unit(a->r->l);
+    lp.nblocks = lp.count < LOOP_BLOCKS ? lp.count : LOOP_BLOCKS;
+    lp.partial = calloc(lp.nblocks * lp.nred + 1, sizeof(val_t));
+    if (!lp.partial) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    deal_blocks(lp.ranges, lp.nblocks);
+
+    share_values();
+    run_on_pool(run_blocks, &lp);
+    free_ranges(lp.ranges);
+    pthread_mutex_unlock(&pool.busy);
+    ctx = lp.parent;
+    unshare_values();
+
+    if (lp.failed) {
+        for (int i = 0; i < lp.nblocks * lp.nred; i++) drop_value(lp.partial[i]);
+        free_loop(&lp);
+        stop_script();
+    }
+    for (int b = 0; b < lp.nblocks; b++) {
+        for (int r = 0; r < lp.nred; r++) combine(&lp.red[r], lp.partial[b * lp.nred + r]);
+    }
+    *v = (val_t){.type = 1, .data.number = lp.start + lp.count * lp.step};
+    free_loop(&lp);
+    return 1;
+}
+
+/* map, filter or reduce of a list */
+struct apply {
+    enum bifs functype;
+    struct symbol fn;               /* copy, the symbol can move */
+    struct synthax_ctx *parent;
+    struct list *lst;
+    int n;                          /* elements */
+    int nblocks;
+    val_t init;                     /* of reduce */
+    struct range ranges[MAX_THREADS];
+    int failed;
+    val_t *partial;                 /* list of each block */
+};
+
+/* a block going through its elements */
+struct pass {
+    struct apply *ap;
+    struct list *out;               /* map and filter */
+    val_t acc;                      /* reduce */
+};
+
+static void apply_element(val_t *e, void *arg) {
+    struct pass *ps = arg;
+    val_t x = *e, v;
+
+    if (__atomic_load_n(&ps->ap->failed, __ATOMIC_RELAXED)) return;
+    x = element_of_value(x); /* for the parameter */
+    switch (ps->ap->functype) {
+        case B_map:
+            v = call_function(&ps->ap->fn, &x, 1);
+            list_push(ps->out, element_of_value(v));
+            drop_value(v);
+            break;
+        case B_filter:
+            v = call_function(&ps->ap->fn, &x, 1);
+            if (v.data.number != 0) list_push(ps->out, element_of_value(*e));
+            drop_value(v);
+            break;
+        default: {
+            val_t args[2] = { ps->acc, x };
+            ps->acc = call_function(&ps->ap->fn, args, 2);
+        }
+    }
+}
+
+static val_t apply_block(struct apply *ap, int b) {
+    struct pass ps = { .ap = ap, .acc = ap->init };
+    int first = (long)ap->n * b / ap->nblocks, end = (long)ap->n * (b + 1) / ap->nblocks;
+
+    if (ap->functype == B_reduce) {
+        list_foreach_range(ap->lst, first, end, apply_element, &ps);
+        return ps.acc;
+    }
+    ps.out = new_list(ap->functype == B_map ? end - first : 0);
+    list_foreach_range(ap->lst, first, end, apply_element, &ps);
+    if (ps.out->length) return (val_t){.type = 3, .data.list = ps.out};
+    list_release(ps.out);
+    return (val_t){.type = 3, .data.list = NULL};
+}
+
+/* what each thread of the pool does, as run_blocks() */
+static void apply_blocks(void *arg, int id) {
+    struct apply *ap = arg;
+    struct synthax_ctx *w = synthax_ctx_share(ap->parent);
+    jmp_buf stop;
+    int b;
+
+    w->stop = &stop;
+    if (setjmp(stop)) {
+        __atomic_store_n(&ap->failed, 1, __ATOMIC_RELAXED);
+    } else {
+        while (!__atomic_load_n(&ap->failed, __ATOMIC_RELAXED) &&
+               (b = next_block(ap->ranges, id)) >= 0)
+            ap->partial[b] = apply_block(ap, b);
+    }
+    while (ctx->scope_top > ap->parent->scope_top) pop_scope();
+    synthax_ctx_unshare(w);
+}
+
+/* the blocks of a long list on the threads, 0 when it has to be done by
+   the calling thread */
+static int apply_on_pool(struct apply *ap) {
+    struct loop check = { 0 };
+    int safe = ap->n >= APPLY_SERIAL && pool_size() >= 2 && safe_call(&check, &ap->fn);
+
+    free(check.seen);
+    if (!safe || pthread_mutex_trylock(&pool.busy)) return 0;
+    ap->nblocks = ap->n / APPLY_BLOCK < LOOP_BLOCKS ? ap->n / APPLY_BLOCK : LOOP_BLOCKS;
+    ap->partial = calloc(ap->nblocks, sizeof(val_t));
+    if (!ap->partial) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    deal_blocks(ap->ranges, ap->nblocks);
+
+    share_values();
+    run_on_pool(apply_blocks, ap);
+    free_ranges(ap->ranges);
+    pthread_mutex_unlock(&pool.busy);
+    ctx = ap->parent;
+    unshare_values();
+
+    if (ap->failed) {
+        for (int b = 0; b < ap->nblocks; b++) drop_value(ap->partial[b]);
+        free(ap->partial);
+        stop_script();
+    }
+    return 1;
+}
+
+/* map(lst, fn), filter(lst, fn) or reduce(lst, fn, init), lst and init
+   are given to it */
+val_t apply_function(enum bifs functype, struct symbol *fn, val_t lst, val_t init) {
+    const char *name = functype == B_map ? "map" : functype == B_filter ? "filter" : "reduce";
+    struct apply ap = { .functype = functype, .parent = ctx, .init = init, .nblocks = 1 };
+    val_t v;
+
+    if (lst.type != 3 || !fn->func) {
+        if (lst.type != 3) yyerror("%s() expects a list", name);
+        else yyerror("Call to undefined function: %s", fn->name);
+        drop_value(lst);
+        drop_value(init);
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+    /* the vm compiles a function at its first call, before the threads do */
+    if (ctx->engine == ENGINE_VM && !fn->code) fn->code = compile_function(fn);
+    ap.fn = *fn;
+    ap.lst = lst.data.list;
+    ap.n = list_length(ap.lst);
+    if (functype == B_reduce || !apply_on_pool(&ap)) {
+        v = apply_block(&ap, 0);
+        drop_value(lst);
+        return v;
+    }
+
+    v = ap.partial[0];
+    for (int b = 1; b < ap.nblocks; b++) {
+        if (!ap.partial[b].data.list) continue;
+        if (v.data.list) {
+            struct list *joined = concat_lists(v.data.list, ap.partial[b].data.list);
+            list_release(v.data.list);
+            list_release(ap.partial[b].data.list);
+            v.data.list = joined;
+        } else {
+            v.data.list = ap.partial[b].data.list;
+        }
+    }
+    free(ap.partial);
+    drop_value(lst);
+    return v;
+}
+
+/* Tasks are numbered from 1 in the order they are spawned, the task of
+   number n is kept at n - 1 in a table of chunks of TASK_CHUNK with its
+   result, which each await of it gives: eval() runs the operands of print
+   and of some operators twice. The call is freed once it has run, the
+   rest once the task that spawned it has given back, after which nothing
+   can await it, and the task has run. A chunk goes when its tasks have.
+   The tasks of the script are kept until its context is freed */
+#define TASK_CHUNK 4096
+#define TASK_CHUNKS 16384
+
+/* state of a task */
+#define TASK_DONE 1                 /* it has run */
+#define TASK_ORPHAN 2               /* the task that spawned it has given back */
+
+struct call {
+    struct symbol fn;               /* copy, the symbol can move */
+    int nargs;
+    val_t args[];
+};
+
+struct task {
+    struct call *call;              /* NULL once it has run */
+    long number;
+    long parent;                    /* task that spawned it, 0 for the script */
+    val_t result;
+    int state;
+    struct task *children;          /* spawned by the task, still kept */
+    struct task *sibling;           /* next child of the task that spawned it */
+};
+
+/* tasks of a thread: it pushes and pops them at the back, the other
+   threads steal them at the front */
+struct deque {
+    pthread_mutex_t lock;
+    struct task **items;
+    int head, tail, size;
+};
+
+struct tasks {
+    struct deque deques[MAX_THREADS];   /* one for each thread of the pool */
+    int ndeques;
+    long spawned;
+    pthread_mutex_t table;              /* for chunks and kept */
+    struct task **chunks[TASK_CHUNKS];
+    int kept[TASK_CHUNKS];              /* slots of a chunk not yet freed */
+};
+
+/* an await the threads of the pool help with */
+struct waiting {
+    struct tasks *tasks;
+    struct task *target;
+    struct synthax_ctx *parent;
+    int failed;
+};
+
+static __thread int worker;                 /* deque of the thread */
+static __thread struct waiting *helping;    /* await the thread helps with */
+
+static struct tasks *new_tasks() {
+    struct tasks *ts = calloc(1, sizeof(struct tasks));
+
+    if (!ts) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    ts->ndeques = pool_size();
+    for (int d = 0; d < ts->ndeques; d++) pthread_mutex_init(&ts->deques[d].lock, NULL);
+    pthread_mutex_init(&ts->table, NULL);
+    return ctx->tasks = ts;
+}
+
+static void push_task(struct deque *d, struct task *t) {
+    pthread_mutex_lock(&d->lock);
+    if (d->tail == d->size) {
+        if (d->head > 0) {
+            memmove(d->items, d->items + d->head, (d->tail - d->head) * sizeof(struct task *));
+            d->tail -= d->head;
+            d->head = 0;
+        } else {
+            d->size = d->size ? 2 * d->size : 64;
+            d->items = realloc(d->items, d->size * sizeof(struct task *));
+            if (!d->items) {
+                yyerror("Out of memory");
+                exit(1);
+            }
+        }
+    }
+    d->items[d->tail++] = t;
+    pthread_mutex_unlock(&d->lock);
+}
+
+/* task at the back (back = 1) or at the front, NULL when it is empty */
+static struct task *take_task(struct deque *d, int back) {
+    struct task *t = NULL;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) t = back ? d->items[--d->tail] : d->items[d->head++];
+    if (d->head == d->tail) d->head = d->tail = 0;
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+static struct task *next_task(struct tasks *ts, int id) {
+    struct task *t = take_task(&ts->deques[id], 1);
+
+    for (int k = 1; !t && k < ts->ndeques; k++) t = take_task(&ts->deques[(id + k) % ts->ndeques], 0);
+    return t;
+}
+
+/* number of the new task t, 0 when the table is full */
+static long add_task(struct tasks *ts, struct task *t) {
+    long i = __atomic_load_n(&ts->spawned, __ATOMIC_RELAXED);
+    struct task ***chunk;
+
+    do {
+        if (i >= (long)TASK_CHUNK * TASK_CHUNKS) return 0;
+    } while (!__atomic_compare_exchange_n(&ts->spawned, &i, i + 1, 0, __ATOMIC_SEQ_CST,
+                                          __ATOMIC_RELAXED));
+    chunk = &ts->chunks[i / TASK_CHUNK];
+    /* a chunk is only freed once all its tasks were added */
+    if (!__atomic_load_n(chunk, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&ts->table);
+        if (!*chunk) {
+            struct task **c = calloc(TASK_CHUNK, sizeof(struct task *));
+            if (!c) {
+                yyerror("Out of memory");
+                exit(1);
+            }
+            ts->kept[i / TASK_CHUNK] = TASK_CHUNK;
+            __atomic_store_n(chunk, c, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&ts->table);
+    }
+    __atomic_store_n(&(*chunk)[i % TASK_CHUNK], t, __ATOMIC_RELEASE);
+    return i + 1;
+}
+
+/* the task of number n, NULL once it is freed */
+static struct task *find_task(struct tasks *ts, long n) {
+    struct task **chunk, *t = NULL;
+
+    pthread_mutex_lock(&ts->table);
+    chunk = ts->chunks[(n - 1) / TASK_CHUNK];
+    if (chunk) t = __atomic_load_n(&chunk[(n - 1) % TASK_CHUNK], __ATOMIC_ACQUIRE);
+    pthread_mutex_unlock(&ts->table);
+    return t;
+}
+
+/* the task has run and nothing can await it any more */
+static void free_task(struct tasks *ts, struct task *t) {
+    long i = t->number - 1;
+
+    drop_value(t->result);
+    pthread_mutex_lock(&ts->table);
+    ts->chunks[i / TASK_CHUNK][i % TASK_CHUNK] = NULL;
+    if (--ts->kept[i / TASK_CHUNK] == 0) {
+        free(ts->chunks[i / TASK_CHUNK]);
+        ts->chunks[i / TASK_CHUNK] = NULL;
+    }
+    pthread_mutex_unlock(&ts->table);
+    free(t);
+}
+
+/* runs t, then frees the tasks it spawned, or leaves the ones still
+   running to the thread that runs them */
+static void run_task(struct tasks *ts, struct task *t) {
+    struct call *c = t->call;
+    struct task *outer = ctx->running;
+
+    ctx->running = t;
+    t->result = call_function(&c->fn, c->args, c->nargs);
+    ctx->running = outer;
+    t->call = NULL;
+    free(c);
+    for (struct task *child = t->children, *next; child; child = next) {
+        next = child->sibling;
+        if (__atomic_fetch_or(&child->state, TASK_ORPHAN, __ATOMIC_ACQ_REL) & TASK_DONE)
+            free_task(ts, child);
+    }
+    t->children = NULL;
+    if (__atomic_fetch_or(&t->state, TASK_DONE, __ATOMIC_ACQ_REL) & TASK_ORPHAN) free_task(ts, t);
+}
+
+/* spawn fn(args): the task of fn, which is given the args, runs when a
+   thread waits on an await, or at once when it could be seen. Returns
+   the number of the task, 0 after an error */
+val_t spawn_task(struct symbol *fn, val_t *args, int nargs) {
+    struct tasks *ts = ctx->tasks ? ctx->tasks : new_tasks();
+    struct loop check = { .task = 1 };
+    struct symlist *sl;
+    struct task *t;
+    int params = 0, deferred;
+
+    for (sl = fn->syms; sl; sl = sl->next) params++;
+    if (!fn->func || nargs < params) {
+        if (!fn->func) yyerror("Call to undefined function: %s", fn->name);
+        else yyerror("Too few args in call to %s", fn->name);
+        for (int i = 0; i < nargs; i++) drop_value(args[i]);
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+    /* compiles fn for the vm before it is copied */
+    deferred = safe_call(&check, fn);
+    free(check.seen);
+    t = malloc(sizeof(struct task));
+    if (!t || !(t->call = malloc(sizeof(struct call) + nargs * sizeof(val_t)))) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    t->call->fn = *fn;
+    t->call->nargs = nargs;
+    memcpy(t->call->args, args, nargs * sizeof(val_t));
+    t->parent = ctx->running ? ctx->running->number : 0;
+    t->state = 0;
+    t->children = NULL;
+    t->number = add_task(ts, t);
+    if (!t->number) {
+        for (int i = 0; i < nargs; i++) drop_value(args[i]);
+        free(t->call);
+        free(t);
+        yyerror("Too many tasks");
+        stop_script();
+    }
+    /* the script's tasks are kept, others until their parent gives back */
+    if (ctx->running) {
+        t->sibling = ctx->running->children;
+        ctx->running->children = t;
+    }
+    if (deferred) push_task(&ts->deques[worker], t);
+    else run_task(ts, t);
+    return (val_t){.type = 1, .data.number = t->number};
+}
+
+/* run tasks until target is done. A thread helping the pool stops when
+   another one failed, the script's thread alone always finds a task */
+static void run_tasks(struct tasks *ts, struct task *target) {
+    while (!(__atomic_load_n(&target->state, __ATOMIC_ACQUIRE) & TASK_DONE)) {
+        struct task *t = next_task(ts, worker);
+
+        if (helping && __atomic_load_n(&helping->failed, __ATOMIC_RELAXED)) longjmp(*ctx->stop, 1);
+        if (t) {
+            run_task(ts, t);
+        } else if (helping) {
+            sched_yield();
+        } else {
+            yyerror("A task awaited can never run");
+            stop_script();
+        }
+    }
+}
+
+/* what each thread of the pool does while the script waits */
+static void help(void *arg, int id) {
+    struct waiting *wt = arg;
+    struct synthax_ctx *w = synthax_ctx_share(wt->parent);
+    jmp_buf stop;
+
+    w->stop = &stop;
+    w->tasks = wt->tasks;
+    worker = id;
+    helping = wt;
+    if (setjmp(stop))
+        __atomic_store_n(&wt->failed, 1, __ATOMIC_RELAXED);
+    else
+        run_tasks(wt->tasks, wt->target);
+    while (ctx->scope_top > wt->parent->scope_top) pop_scope();
+    helping = NULL;
+    worker = 0;
+    w->tasks = NULL;
+    synthax_ctx_unshare(w);
+}
+
+/* await(task) with the number spawn_task() gave */
+val_t await_task(val_t task) {
+    struct tasks *ts = ctx->tasks;
+    double n = task.data.number;
+    struct task *t;
+
+    if (!ts || !numeric(task.type) || n != floor(n) || n < 1 ||
+            n > __atomic_load_n(&ts->spawned, __ATOMIC_RELAXED)) {
+        yyerror("await() expects a task");
+        drop_value(task);
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+    /* a task of the one running is kept while it runs */
+    t = find_task(ts, (long)n);
+    if (!t || t->parent != (ctx->running ? ctx->running->number : 0)) {
+        if (!t) yyerror("await() expects a task");
+        else yyerror("await() of a task spawned by another task");
+        return (val_t){.type = 1, .data.number = 0.0};
+    }
+
+    if (helping || ts->ndeques < 2 || pthread_mutex_trylock(&pool.busy)) {
+        run_tasks(ts, t);
+    } else if (!(__atomic_load_n(&t->state, __ATOMIC_ACQUIRE) & TASK_DONE)) {
+        struct waiting wt = { .tasks = ts, .target = t, .parent = ctx };
+
+        share_values();
+        run_on_pool(help, &wt);
+        pthread_mutex_unlock(&pool.busy);
+        ctx = wt.parent;
+        unshare_values();
+        if (wt.failed) stop_script();
+    } else {
+        pthread_mutex_unlock(&pool.busy);
+    }
+    return element_of_value(t->result); /* the task keeps its own */
+}
+
+/* the tasks of a context that is freed, awaited or not */
+void tasks_free(struct tasks *ts) {
+    if (!ts) return;
+    for (long c = 0; c < TASK_CHUNKS; c++) {
+        if (!ts->chunks[c]) continue;
+        for (int i = 0; i < TASK_CHUNK; i++) {
+            struct task *t = ts->chunks[c][i];
+
+            if (!t) continue;
+            if (t->state & TASK_DONE) {
+                drop_value(t->result);
+            } else {
+                for (int a = 0; a < t->call->nargs; a++) drop_value(t->call->args[a]);
+                free(t->call);
+            }
+            free(t);
+        }
+        free(ts->chunks[c]);
+    }
+    for (int d = 0; d < ts->ndeques; d++) {
+        free(ts->deques[d].items);
+        pthread_mutex_destroy(&ts->deques[d].lock);
+    }
+    pthread_mutex_destroy(&ts->table);
+    free(ts);
+}
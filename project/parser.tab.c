@@ -55,7 +55,7 @@
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
 
 /* Push parsers.  */
 #define YYPUSH 0
@@ -72,18 +72,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
 #include "helper.h"
 
 int yydebug = 1;
-extern FILE *yyin;
-extern int yylineno;
 
 void print_val(val_t val);
 
-int yylex();
+static void run_statement(struct ast *a);
+static int function_builtin(char *name, struct ast *args);
+static int reserved(char *name);
 
-#line 87 "parser.tab.c"
+#line 88 "parser.tab.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -142,43 +143,64 @@ enum yysymbol_kind_t
   YYSYMBOL_FUNC = 28,                      /* FUNC  */
   YYSYMBOL_DATA_TYPE = 29,                 /* DATA_TYPE  */
   YYSYMBOL_ID = 30,                        /* ID  */
-  YYSYMBOL_CMP = 31,                       /* CMP  */
-  YYSYMBOL_UMINUS = 32,                    /* UMINUS  */
-  YYSYMBOL_33_ = 33,                       /* ';'  */
-  YYSYMBOL_34_ = 34,                       /* '['  */
-  YYSYMBOL_35_ = 35,                       /* ']'  */
-  YYSYMBOL_36_ = 36,                       /* ':'  */
-  YYSYMBOL_37_ = 37,                       /* '{'  */
-  YYSYMBOL_38_ = 38,                       /* '}'  */
-  YYSYMBOL_39_ = 39,                       /* '('  */
-  YYSYMBOL_40_ = 40,                       /* ')'  */
-  YYSYMBOL_41_ = 41,                       /* ','  */
-  YYSYMBOL_YYACCEPT = 42,                  /* $accept  */
-  YYSYMBOL_S = 43,                         /* S  */
-  YYSYMBOL_START = 44,                     /* START  */
-  YYSYMBOL_stmts = 45,                     /* stmts  */
-  YYSYMBOL_stmt = 46,                      /* stmt  */
-  YYSYMBOL_flow = 47,                      /* flow  */
-  YYSYMBOL_declare = 48,                   /* declare  */
-  YYSYMBOL_init = 49,                      /* init  */
-  YYSYMBOL_assignment = 50,                /* assignment  */
-  YYSYMBOL_whether = 51,                   /* whether  */
-  YYSYMBOL_when = 52,                      /* when  */
-  YYSYMBOL_from = 53,                      /* from  */
-  YYSYMBOL_condition = 54,                 /* condition  */
-  YYSYMBOL_expr = 55,                      /* expr  */
-  YYSYMBOL_value = 56,                     /* value  */
-  YYSYMBOL_list = 57,                      /* list  */
-  YYSYMBOL_explist = 58,                   /* explist  */
-  YYSYMBOL_symlist = 59,                   /* symlist  */
-  YYSYMBOL_return = 60,                    /* return  */
-  YYSYMBOL_ufunction = 61,                 /* ufunction  */
-  YYSYMBOL_funcall = 62                    /* funcall  */
+  YYSYMBOL_STREAM = 31,                    /* STREAM  */
+  YYSYMBOL_COMPILE = 32,                   /* COMPILE  */
+  YYSYMBOL_EMPTY = 33,                     /* EMPTY  */
+  YYSYMBOL_CMP = 34,                       /* CMP  */
+  YYSYMBOL_UMINUS = 35,                    /* UMINUS  */
+  YYSYMBOL_36_ = 36,                       /* ';'  */
+  YYSYMBOL_37_ = 37,                       /* '['  */
+  YYSYMBOL_38_ = 38,                       /* ']'  */
+  YYSYMBOL_39_ = 39,                       /* ':'  */
+  YYSYMBOL_40_ = 40,                       /* '{'  */
+  YYSYMBOL_41_ = 41,                       /* '}'  */
+  YYSYMBOL_42_ = 42,                       /* ','  */
+  YYSYMBOL_43_ = 43,                       /* '('  */
+  YYSYMBOL_44_ = 44,                       /* ')'  */
+  YYSYMBOL_YYACCEPT = 45,                  /* $accept  */
+  YYSYMBOL_S = 46,                         /* S  */
+  YYSYMBOL_stream = 47,                    /* stream  */
+  YYSYMBOL_program = 48,                   /* program  */
+  YYSYMBOL_START = 49,                     /* START  */
+  YYSYMBOL_stmts = 50,                     /* stmts  */
+  YYSYMBOL_stmt = 51,                      /* stmt  */
+  YYSYMBOL_flow = 52,                      /* flow  */
+  YYSYMBOL_declare = 53,                   /* declare  */
+  YYSYMBOL_init = 54,                      /* init  */
+  YYSYMBOL_assignment = 55,                /* assignment  */
+  YYSYMBOL_whether = 56,                   /* whether  */
+  YYSYMBOL_when = 57,                      /* when  */
+  YYSYMBOL_from = 58,                      /* from  */
+  YYSYMBOL_parallel = 59,                  /* parallel  */
+  YYSYMBOL_reductions = 60,                /* reductions  */
+  YYSYMBOL_reducelist = 61,                /* reducelist  */
+  YYSYMBOL_reduction = 62,                 /* reduction  */
+  YYSYMBOL_condition = 63,                 /* condition  */
+  YYSYMBOL_expr = 64,                      /* expr  */
+  YYSYMBOL_value = 65,                     /* value  */
+  YYSYMBOL_list = 66,                      /* list  */
+  YYSYMBOL_explist = 67,                   /* explist  */
+  YYSYMBOL_symlist = 68,                   /* symlist  */
+  YYSYMBOL_return = 69,                    /* return  */
+  YYSYMBOL_ufunction = 70,                 /* ufunction  */
+  YYSYMBOL_define = 71,                    /* define  */
+  YYSYMBOL_funcall = 72                    /* funcall  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 
+/* Unqualified %code blocks.  */
+#line 54 "parser.y"
+
+int yylex(YYSTYPE *lval, yyscan_t scanner);
+
+/* --stream and parse_program(): the first token the parser gets,
+   ctx->start_token, selects the stream or the program rules */
+static int next_token(YYSTYPE *lval);
+#define yylex next_token
+
+#line 204 "parser.tab.c"
 
 #ifdef short
 # undef short
@@ -499,21 +521,21 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  3
+#define YYFINAL  7
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   294
+#define YYLAST   370
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  42
+#define YYNTOKENS  45
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  21
+#define YYNNTS  28
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  63
+#define YYNRULES  84
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  139
+#define YYNSTATES  168
 
 /* YYMAXUTOK -- Last valid token kind.  */
-#define YYMAXUTOK   287
+#define YYMAXUTOK   290
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
@@ -531,15 +553,15 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-      39,    40,     2,     2,    41,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,    36,    33,
+      43,    44,     2,     2,    42,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,    39,    36,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,    34,     2,    35,     2,     2,     2,     2,     2,     2,
+       2,    37,     2,    38,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,    37,     2,    38,     2,     2,     2,     2,
+       2,     2,     2,    40,     2,    41,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -555,20 +577,23 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
       15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
-      25,    26,    27,    28,    29,    30,    31,    32
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
+      35
 };
 
 #if YYDEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_uint8 yyrline[] =
 {
-       0,    49,    49,    51,    52,    53,    54,    55,    58,    63,
-      64,    70,    73,    74,    75,    76,    77,    80,    81,    82,
-      84,    91,    92,    94,    96,    97,   100,   101,   105,   113,
-     114,   115,   116,   117,   118,   120,   121,   122,   123,   124,
-     125,   126,   127,   128,   129,   130,   132,   133,   134,   135,
-     136,   137,   138,   140,   141,   144,   145,   147,   148,   150,
-     152,   153,   155,   156
+       0,    65,    65,    66,    67,    72,    73,    74,    75,    76,
+      80,    81,    82,    83,    86,    87,    88,    89,    90,    93,
+      98,    99,   105,   108,   109,   110,   111,   112,   115,   116,
+     117,   119,   126,   127,   129,   131,   132,   135,   136,   140,
+     155,   156,   166,   167,   169,   170,   172,   173,   184,   185,
+     186,   187,   188,   189,   191,   192,   193,   194,   195,   196,
+     197,   198,   199,   200,   201,   203,   204,   205,   206,   207,
+     208,   209,   211,   212,   215,   216,   218,   219,   221,   223,
+     224,   226,   228,   234,   236
 };
 #endif
 
@@ -588,10 +613,12 @@ static const char *const yytname[] =
   "WHEN", "OTHERWISE", "WHETHER", "RETURN", "DEFINE", "UNTIL", "THEN",
   "AND", "OR", "NOT", "PLUS", "MINUS", "MUL", "DIV", "POW", "ASSIGN",
   "ABS", "MOD", "NUM", "BINARY", "ROMAN", "STR", "FUNC", "DATA_TYPE", "ID",
-  "CMP", "UMINUS", "';'", "'['", "']'", "':'", "'{'", "'}'", "'('", "')'",
-  "','", "$accept", "S", "START", "stmts", "stmt", "flow", "declare",
-  "init", "assignment", "whether", "when", "from", "condition", "expr",
-  "value", "list", "explist", "symlist", "return", "ufunction", "funcall", YY_NULLPTR
+  "STREAM", "COMPILE", "EMPTY", "CMP", "UMINUS", "';'", "'['", "']'",
+  "':'", "'{'", "'}'", "','", "'('", "')'", "$accept", "S", "stream",
+  "program", "START", "stmts", "stmt", "flow", "declare", "init",
+  "assignment", "whether", "when", "from", "parallel", "reductions",
+  "reducelist", "reduction", "condition", "expr", "value", "list",
+  "explist", "symlist", "return", "ufunction", "define", "funcall", YY_NULLPTR
 };
 
 static const char *
@@ -601,12 +628,12 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-43)
+#define YYPACT_NINF (-49)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
 
-#define YYTABLE_NINF (-15)
+#define YYTABLE_NINF (-66)
 
 #define yytable_value_is_error(Yyn) \
   0
@@ -615,20 +642,23 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int16 yypact[] =
 {
-     -43,     5,    39,   -43,   -43,   -21,   -25,   -20,   229,     8,
-     229,   229,   -43,   -43,   -43,   -43,    -9,    13,   -17,   213,
-     229,   -43,    27,   176,   -43,   -43,   -43,   -43,   -43,   271,
-     -43,   -43,   -43,   -43,    41,    47,    66,   176,    66,    38,
-     271,   -43,    43,   -43,   263,   229,    59,   229,   229,   -43,
-       0,    50,   119,   176,   -43,   229,   229,   229,   229,   229,
-     229,    82,    66,    66,    -3,   253,    49,    11,    12,   -43,
-      55,   229,   -43,   271,    58,   229,   -43,   -43,   -43,    52,
-      52,   -43,   -43,    52,   -43,   229,    23,    -6,   205,    66,
-      66,    62,   229,    91,    94,    69,    70,    63,   -43,   271,
-     -43,   -43,   128,   -43,    23,    23,   176,   271,    77,    76,
-      88,   176,    83,   229,    81,    66,    85,   -43,    89,   176,
-     154,   -43,    15,   176,   -43,    92,    86,   -43,    95,   -43,
-     176,   122,   102,    90,   -43,   112,   176,   116,   -43
+      27,   -49,   -49,    17,   155,   194,   233,   -49,   -49,     8,
+      -3,   -31,   319,   -49,   319,   319,   -49,   -49,   -49,   -49,
+     -16,    25,    63,   297,   319,   -49,    26,   260,   -49,   -49,
+     -49,   -49,   -49,   255,   -49,   -49,   -49,   -49,    36,    28,
+      38,    40,   -49,   -49,    56,   -49,   -49,   -49,    10,   283,
+     260,   283,   -14,   255,   -49,   -49,   347,   319,    51,   319,
+     -14,   319,   -49,   -49,   111,    45,    34,   260,   -49,   319,
+     319,   319,   319,   319,   319,    52,   -49,   -49,   -49,    69,
+     283,   283,    -6,   334,    58,     7,   -49,    57,   319,   -49,
+     255,    59,   319,   -49,   -49,   -49,    -8,    -8,   -49,   -49,
+      -8,   -49,   -11,    98,    47,    -9,   124,   283,   283,    67,
+     319,    99,    97,   -49,   255,   -49,   -49,    70,    71,    72,
+     319,   -49,    47,    47,   260,   255,    77,    79,    85,   260,
+      81,   229,    78,   283,    82,   -49,    94,   260,   319,   -49,
+      11,   260,   -49,   104,   170,   -49,   105,   -49,   101,   141,
+     120,   117,   112,     6,   128,   125,   260,   122,   -49,   -49,
+     -49,   120,   129,   260,   -49,   -49,   135,   -49
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -636,36 +666,39 @@ static const yytype_int16 yypact[] =
    means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
-       3,     0,     0,     1,     6,     0,     0,     0,    46,     0,
-      46,    46,    47,    48,    49,    51,     0,     0,    50,    46,
-      46,     4,     0,    11,    12,    13,    17,    18,    19,    16,
-      44,    52,    15,     5,    45,     0,    46,    46,    46,    50,
-      59,    45,     0,    42,     0,    46,    22,    46,    46,    53,
-      55,     0,     0,     9,    10,    46,    46,    46,    46,    46,
-      46,     0,    46,    46,     0,    34,     0,     0,     0,    41,
-       0,    46,    20,    23,     0,    46,    54,    43,     8,    35,
-      36,    37,    38,    39,    40,    46,    32,     0,    34,    46,
-      46,     0,    46,     0,     0,    57,     0,     0,    63,    21,
-      62,    56,     0,    33,    30,    31,    46,    29,     0,     0,
-       0,    46,     0,    46,     0,    46,     0,    58,     0,    46,
-       0,    26,     0,    46,    61,     0,     0,    27,     0,    60,
-      46,    24,     0,     0,    28,     0,    46,     0,    25
+      14,     5,    10,     0,     0,     0,    65,     1,    17,    40,
+       0,     0,    65,    81,    65,    65,    66,    67,    68,    70,
+       0,     0,    69,    65,    65,    15,     0,    22,    23,    24,
+      28,    29,    30,    27,    63,    71,    26,    16,     0,    64,
+       0,     0,     7,     8,     0,    12,    13,    41,     0,    65,
+      65,    65,    69,    78,    64,    61,     0,    65,    33,    65,
+       0,    65,    84,    72,    74,     0,     0,    20,    21,    65,
+      65,    65,    65,    65,    65,     0,     9,     6,    11,     0,
+      65,    65,     0,    53,     0,     0,    60,     0,    65,    31,
+      34,     0,    65,    73,    62,    19,    54,    55,    56,    57,
+      58,    59,     0,     0,    51,     0,    53,    65,    65,     0,
+      65,     0,     0,    83,    32,    82,    75,    76,     0,     0,
+      65,    52,    49,    50,    65,    48,     0,     0,     0,    65,
+       0,     0,     0,    65,     0,    77,     0,    65,    65,    37,
+       0,    65,    80,     0,     0,    38,     0,    79,    42,    35,
+       0,     0,     0,     0,     0,    44,    65,     0,    46,    47,
+      43,     0,     0,    65,    45,    39,     0,    36
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -43,   -43,   -43,   -22,   -43,   -43,    97,   -43,   -43,   -43,
-     -43,   -43,   -36,   105,   -43,   -43,   -42,    45,   -43,   -43,
-      -2
+     -49,   -49,   -49,   -49,   -49,   -24,    65,    74,    90,   -49,
+     -49,   -49,   -49,   -49,   -49,   -49,    35,   -49,   -39,    16,
+     -49,   -49,   -48,    73,   -49,    76,   -49,    -4
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int8 yydefgoto[] =
+static const yytype_uint8 yydefgoto[] =
 {
-       0,     1,     2,    21,    22,    23,    24,    72,    25,    26,
-      27,    28,    64,    29,    30,    31,    51,    97,    32,    33,
-      41
+       0,     3,     5,     6,     4,    25,    26,    27,    28,    89,
+      29,    30,    31,    32,    48,   151,   154,   155,    82,    33,
+      34,    35,    65,   119,    36,    37,    38,    54
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -673,114 +706,137 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int16 yytable[] =
 {
-      34,    54,    67,    70,    47,     3,    74,    89,    90,    36,
-      89,    90,    37,    35,    38,    66,    55,    56,    57,    58,
-      59,    34,    48,    60,    89,    90,    86,    87,    89,    90,
-      45,    78,    91,   101,   103,    34,    89,    90,    42,    -2,
-       4,    75,    95,    46,     5,     6,    94,     7,     8,     9,
-     127,    34,    96,   104,   105,    -7,    10,    -7,    -7,    -7,
-      53,    11,    -7,    12,    13,    14,    15,    16,    17,    18,
-      57,    58,    -7,    19,   -14,    60,    17,    48,    20,   122,
-      71,    62,    68,    10,   114,    76,    85,    93,    11,   118,
-      12,    13,    14,    15,    16,    98,    39,   125,   100,   106,
-      19,   128,   108,   112,    34,    63,   109,   111,   132,    34,
-     110,   115,   116,    40,   137,    43,    44,    34,    95,   121,
-     119,    34,   123,   130,    50,    52,   135,   124,    34,   133,
-     129,   113,    61,   131,    34,    55,    56,    57,    58,    59,
-     134,    65,    60,    65,    55,    56,    57,    58,    59,   136,
-      50,    60,    73,    50,   138,   117,     0,     0,     0,    77,
-      79,    80,    81,    82,    83,    84,     0,    65,    88,     0,
-      55,    56,    57,    58,    59,     0,    99,    60,     0,     0,
-      50,     5,     6,     0,     7,     8,     0,     0,     0,   126,
-     102,     0,     0,    10,    65,    65,     0,   107,    11,     0,
-      12,    13,    14,    15,    16,    17,    18,     0,     0,     0,
-      19,     0,     0,     0,     0,    20,     0,     0,   120,     0,
-      65,    55,    56,    57,    58,    59,     0,     0,    60,     0,
-      10,     0,     0,     0,     0,    11,    92,    12,    13,    14,
-      15,    16,     0,    39,     0,    77,    10,    19,    49,     0,
-       0,    11,    20,    12,    13,    14,    15,    16,     0,    39,
-       0,     0,     0,    19,     0,     0,     0,     0,    20,    55,
-      56,    57,    58,    59,     0,     0,    60,     0,     0,    55,
-      56,    57,    58,    59,    92,    69,    60,    55,    56,    57,
-      58,    59,     0,     0,    60
+      39,    39,    39,    68,   107,   108,    51,   107,   108,    87,
+      71,    72,    85,    91,    20,    74,    60,     7,    62,   117,
+     107,   108,   158,    39,   107,   108,    84,    57,    53,    61,
+      55,    56,   109,   118,    49,   121,   159,    50,    47,    64,
+      66,   104,   105,    95,   116,   112,    39,    79,    62,   145,
+      69,    70,    71,    72,    73,    58,    62,    74,     1,     2,
+     107,   108,    67,    39,   -25,    83,    75,    83,   122,   123,
+      41,    44,    88,    64,    76,    90,    77,    64,    94,    42,
+      45,    43,    46,    93,    59,    96,    97,    98,    99,   100,
+     101,    20,    78,    60,   140,   102,    83,   106,    21,   111,
+     132,   113,   120,   115,   114,   136,    61,   124,    64,   127,
+     126,   129,   128,   143,   133,   117,   130,   146,   134,   139,
+      39,   137,   141,    83,    83,    39,   125,    69,    70,    71,
+      72,    73,   162,    39,    74,   142,   131,    39,   150,   166,
+      69,    70,    71,    72,    73,   147,   149,    74,   152,    83,
+     153,   157,    39,    92,   144,    -2,     8,   156,   110,    39,
+       9,    10,   163,    11,    12,    13,   160,   161,    94,   103,
+     165,   -18,    14,   -18,   -18,   -18,   167,    15,   -18,    16,
+      17,    18,    19,    20,    21,    22,    69,    70,    71,    72,
+      73,   -18,    23,    74,    -3,    40,   164,     0,    24,     9,
+      10,   135,    11,    12,    13,     0,     0,     0,   148,     0,
+     -65,    14,   -65,   -65,   -65,     0,    15,   -65,    16,    17,
+      18,    19,    20,    21,    22,     0,     0,     0,     0,     0,
+     -65,    23,   138,    -4,     0,     0,     0,    24,     9,    10,
+       0,    11,    12,    13,     0,    69,    70,    71,    72,    73,
+      14,     0,    74,     0,     0,    15,     0,    16,    17,    18,
+      19,    20,    21,    22,     0,     9,    10,     0,    11,    12,
+      23,    69,    70,    71,    72,    73,    24,    14,    74,     0,
+       0,     0,    15,     0,    16,    17,    18,    19,    20,    21,
+      22,     0,     0,     0,     0,     0,     0,    23,    80,     0,
+      14,     0,     0,    24,     0,    15,     0,    16,    17,    18,
+      19,    20,     0,    52,    14,     0,     0,     0,     0,    15,
+      23,    16,    17,    18,    19,    20,    81,    52,     0,     0,
+       0,     0,     0,     0,    23,    63,    14,     0,     0,     0,
+      24,    15,     0,    16,    17,    18,    19,    20,     0,    52,
+      69,    70,    71,    72,    73,     0,    23,    74,     0,     0,
+       0,     0,    24,    69,    70,    71,    72,    73,   110,    86,
+      74
 };
 
 static const yytype_int16 yycheck[] =
 {
-       2,    23,    38,    45,    21,     0,    48,    13,    14,    34,
-      13,    14,    37,    34,    34,    37,    16,    17,    18,    19,
-      20,    23,    39,    23,    13,    14,    62,    63,    13,    14,
-      39,    53,    35,    75,    40,    37,    13,    14,    30,     0,
-       1,    41,    30,    30,     5,     6,    35,     8,     9,    10,
-      35,    53,    40,    89,    90,    16,    17,    18,    19,    20,
-      33,    22,    23,    24,    25,    26,    27,    28,    29,    30,
-      18,    19,    33,    34,    33,    23,    29,    39,    39,   115,
-      21,    15,    39,    17,   106,    35,     4,    38,    22,   111,
-      24,    25,    26,    27,    28,    40,    30,   119,    40,    37,
-      34,   123,    11,    40,   106,    39,    12,    37,   130,   111,
-      41,    34,    36,     8,   136,    10,    11,   119,    30,    38,
-      37,   123,    37,    37,    19,    20,    36,    38,   130,     7,
-      38,     3,    35,    38,   136,    16,    17,    18,    19,    20,
-      38,    36,    23,    38,    16,    17,    18,    19,    20,    37,
-      45,    23,    47,    48,    38,   110,    -1,    -1,    -1,    40,
-      55,    56,    57,    58,    59,    60,    -1,    62,    63,    -1,
-      16,    17,    18,    19,    20,    -1,    71,    23,    -1,    -1,
-      75,     5,     6,    -1,     8,     9,    -1,    -1,    -1,    35,
-      85,    -1,    -1,    17,    89,    90,    -1,    92,    22,    -1,
-      24,    25,    26,    27,    28,    29,    30,    -1,    -1,    -1,
-      34,    -1,    -1,    -1,    -1,    39,    -1,    -1,   113,    -1,
-     115,    16,    17,    18,    19,    20,    -1,    -1,    23,    -1,
-      17,    -1,    -1,    -1,    -1,    22,    31,    24,    25,    26,
-      27,    28,    -1,    30,    -1,    40,    17,    34,    35,    -1,
-      -1,    22,    39,    24,    25,    26,    27,    28,    -1,    30,
-      -1,    -1,    -1,    34,    -1,    -1,    -1,    -1,    39,    16,
-      17,    18,    19,    20,    -1,    -1,    23,    -1,    -1,    16,
-      17,    18,    19,    20,    31,    22,    23,    16,    17,    18,
-      19,    20,    -1,    -1,    23
+       4,     5,     6,    27,    13,    14,    37,    13,    14,    57,
+      18,    19,    51,    61,    28,    23,    30,     0,    22,    30,
+      13,    14,    16,    27,    13,    14,    50,    43,    12,    43,
+      14,    15,    38,    44,    37,    44,    30,    40,    30,    23,
+      24,    80,    81,    67,    92,    38,    50,    37,    52,    38,
+      16,    17,    18,    19,    20,    30,    60,    23,    31,    32,
+      13,    14,    36,    67,    36,    49,    30,    51,   107,   108,
+       5,     6,    21,    57,    36,    59,    36,    61,    44,     5,
+       6,     5,     6,    38,    21,    69,    70,    71,    72,    73,
+      74,    28,    36,    30,   133,    43,    80,    81,    29,    41,
+     124,    44,     4,    44,    88,   129,    43,    40,    92,    12,
+      11,    40,    42,   137,    37,    30,    44,   141,    39,    41,
+     124,    40,    40,   107,   108,   129,   110,    16,    17,    18,
+      19,    20,   156,   137,    23,    41,   120,   141,    37,   163,
+      16,    17,    18,    19,    20,    41,    41,    23,     7,   133,
+      30,    39,   156,    42,   138,     0,     1,    40,    34,   163,
+       5,     6,    40,     8,     9,    10,    38,    42,    44,    79,
+      41,    16,    17,    18,    19,    20,    41,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    16,    17,    18,    19,
+      20,    36,    37,    23,     0,     1,   161,    -1,    43,     5,
+       6,   128,     8,     9,    10,    -1,    -1,    -1,    38,    -1,
+      16,    17,    18,    19,    20,    -1,    22,    23,    24,    25,
+      26,    27,    28,    29,    30,    -1,    -1,    -1,    -1,    -1,
+      36,    37,     3,     0,    -1,    -1,    -1,    43,     5,     6,
+      -1,     8,     9,    10,    -1,    16,    17,    18,    19,    20,
+      17,    -1,    23,    -1,    -1,    22,    -1,    24,    25,    26,
+      27,    28,    29,    30,    -1,     5,     6,    -1,     8,     9,
+      37,    16,    17,    18,    19,    20,    43,    17,    23,    -1,
+      -1,    -1,    22,    -1,    24,    25,    26,    27,    28,    29,
+      30,    -1,    -1,    -1,    -1,    -1,    -1,    37,    15,    -1,
+      17,    -1,    -1,    43,    -1,    22,    -1,    24,    25,    26,
+      27,    28,    -1,    30,    17,    -1,    -1,    -1,    -1,    22,
+      37,    24,    25,    26,    27,    28,    43,    30,    -1,    -1,
+      -1,    -1,    -1,    -1,    37,    38,    17,    -1,    -1,    -1,
+      43,    22,    -1,    24,    25,    26,    27,    28,    -1,    30,
+      16,    17,    18,    19,    20,    -1,    37,    23,    -1,    -1,
+      -1,    -1,    43,    16,    17,    18,    19,    20,    34,    22,
+      23
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,    43,    44,     0,     1,     5,     6,     8,     9,    10,
-      17,    22,    24,    25,    26,    27,    28,    29,    30,    34,
-      39,    45,    46,    47,    48,    50,    51,    52,    53,    55,
-      56,    57,    60,    61,    62,    34,    34,    37,    34,    30,
-      55,    62,    30,    55,    55,    39,    30,    21,    39,    35,
-      55,    58,    55,    33,    45,    16,    17,    18,    19,    20,
-      23,    48,    15,    39,    54,    55,    45,    54,    39,    22,
-      58,    21,    49,    55,    58,    41,    35,    40,    45,    55,
-      55,    55,    55,    55,    55,     4,    54,    54,    55,    13,
-      14,    35,    31,    38,    35,    30,    40,    59,    40,    55,
-      40,    58,    55,    40,    54,    54,    37,    55,    11,    12,
-      41,    37,    40,     3,    45,    34,    36,    59,    45,    37,
-      55,    38,    54,    37,    38,    45,    35,    35,    45,    38,
-      37,    38,    45,     7,    38,    36,    37,    45,    38
+       0,    31,    32,    46,    49,    47,    48,     0,     1,     5,
+       6,     8,     9,    10,    17,    22,    24,    25,    26,    27,
+      28,    29,    30,    37,    43,    50,    51,    52,    53,    55,
+      56,    57,    58,    64,    65,    66,    69,    70,    71,    72,
+       1,    51,    52,    70,    51,    52,    70,    30,    59,    37,
+      40,    37,    30,    64,    72,    64,    64,    43,    30,    21,
+      30,    43,    72,    38,    64,    67,    64,    36,    50,    16,
+      17,    18,    19,    20,    23,    30,    36,    36,    36,    37,
+      15,    43,    63,    64,    50,    63,    22,    67,    21,    54,
+      64,    67,    42,    38,    44,    50,    64,    64,    64,    64,
+      64,    64,    43,    53,    63,    63,    64,    13,    14,    38,
+      34,    41,    38,    44,    64,    44,    67,    30,    44,    68,
+       4,    44,    63,    63,    40,    64,    11,    12,    42,    40,
+      44,    64,    50,    37,    39,    68,    50,    40,     3,    41,
+      63,    40,    41,    50,    64,    38,    50,    41,    38,    41,
+      37,    60,     7,    30,    61,    62,    40,    39,    16,    30,
+      38,    42,    50,    40,    61,    41,    50,    41
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,    42,    43,    44,    44,    44,    44,    44,    45,    45,
-      45,    45,    46,    46,    46,    46,    46,    47,    47,    47,
-      48,    49,    49,    50,    51,    51,    52,    52,    53,    54,
-      54,    54,    54,    54,    54,    55,    55,    55,    55,    55,
-      55,    55,    55,    55,    55,    55,    56,    56,    56,    56,
-      56,    56,    56,    57,    57,    58,    58,    59,    59,    60,
-      61,    61,    62,    62
+       0,    45,    46,    46,    46,    47,    47,    47,    47,    47,
+      48,    48,    48,    48,    49,    49,    49,    49,    49,    50,
+      50,    50,    50,    51,    51,    51,    51,    51,    52,    52,
+      52,    53,    54,    54,    55,    56,    56,    57,    57,    58,
+      59,    59,    60,    60,    61,    61,    62,    62,    63,    63,
+      63,    63,    63,    63,    64,    64,    64,    64,    64,    64,
+      64,    64,    64,    64,    64,    65,    65,    65,    65,    65,
+      65,    65,    66,    66,    67,    67,    68,    68,    69,    70,
+      70,    71,    72,    72,    72
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
-       0,     2,     1,     0,     2,     2,     2,     1,     3,     2,
-       2,     1,     1,     1,     1,     1,     1,     1,     1,     1,
-       3,     2,     0,     3,     9,    14,     7,     8,    11,     3,
-       3,     3,     2,     3,     1,     3,     3,     3,     3,     3,
-       3,     3,     2,     3,     1,     1,     0,     1,     1,     1,
-       1,     1,     1,     2,     3,     1,     3,     1,     3,     2,
-       8,     7,     4,     4
+       0,     2,     1,     2,     2,     0,     3,     2,     2,     3,
+       0,     3,     2,     2,     0,     2,     2,     2,     1,     3,
+       2,     2,     1,     1,     1,     1,     1,     1,     1,     1,
+       1,     3,     2,     0,     3,     9,    14,     7,     8,    13,
+       0,     1,     0,     3,     1,     3,     2,     2,     3,     3,
+       3,     2,     3,     1,     3,     3,     3,     3,     3,     3,
+       3,     2,     3,     1,     1,     0,     1,     1,     1,     1,
+       1,     1,     2,     3,     1,     3,     1,     3,     2,     8,
+       7,     1,     4,     4,     2
 };
 
 
@@ -1253,13 +1309,6 @@ yydestruct (const char *yymsg,
 }
 
 
-/* Lookahead token kind.  */
-int yychar;
-
-/* The semantic value of the lookahead symbol.  */
-YYSTYPE yylval;
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 
 
@@ -1271,6 +1320,19 @@ int yynerrs;
 int
 yyparse (void)
 {
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
     yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
     int yyerrstatus = 0;
@@ -1426,7 +1488,7 @@ yybackup:
   if (yychar == YYEMPTY)
     {
       YYDPRINTF ((stderr, "Reading a token\n"));
-      yychar = yylex ();
+      yychar = yylex (&yylval);
     }
 
   if (yychar <= YYEOF)
@@ -1514,374 +1576,515 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* S: START  */
-#line 49 "parser.y"
-         { print_ast((yyvsp[0].a), 0, " ");  }
-#line 1520 "parser.tab.c"
+#line 65 "parser.y"
+         { save_program((yyvsp[0].a)); print_ast((yyvsp[0].a), 0, " "); arena_free_program(); }
+#line 1582 "parser.tab.c"
+    break;
+
+  case 4: /* S: COMPILE program  */
+#line 67 "parser.y"
+                        { ctx->parsed = (yyvsp[0].a); }
+#line 1588 "parser.tab.c"
+    break;
+
+  case 6: /* stream: stream stmt ';'  */
+#line 73 "parser.y"
+                        { run_statement((yyvsp[-1].a)); }
+#line 1594 "parser.tab.c"
+    break;
+
+  case 7: /* stream: stream flow  */
+#line 74 "parser.y"
+                        { run_statement((yyvsp[0].a)); }
+#line 1600 "parser.tab.c"
+    break;
+
+  case 8: /* stream: stream ufunction  */
+#line 75 "parser.y"
+                        { run_statement((yyvsp[0].a)); }
+#line 1606 "parser.tab.c"
+    break;
+
+  case 9: /* stream: stream error ';'  */
+#line 76 "parser.y"
+                        { yyerrok; arena_free(arena_end()); }
+#line 1612 "parser.tab.c"
+    break;
+
+  case 10: /* program: %empty  */
+#line 80 "parser.y"
+                            { (yyval.a) = NULL; }
+#line 1618 "parser.tab.c"
+    break;
+
+  case 11: /* program: program stmt ';'  */
+#line 81 "parser.y"
+                            { (yyval.a) = newast('L', (yyvsp[-2].a), (yyvsp[-1].a)); }
+#line 1624 "parser.tab.c"
     break;
 
-  case 3: /* START: %empty  */
-#line 51 "parser.y"
+  case 12: /* program: program flow  */
+#line 82 "parser.y"
+                            { (yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); }
+#line 1630 "parser.tab.c"
+    break;
+
+  case 13: /* program: program ufunction  */
+#line 83 "parser.y"
+                            { (yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); }
+#line 1636 "parser.tab.c"
+    break;
+
+  case 14: /* START: %empty  */
+#line 86 "parser.y"
                         { (yyval.a) = NULL; }
-#line 1526 "parser.tab.c"
+#line 1642 "parser.tab.c"
     break;
 
-  case 4: /* START: START stmts  */
-#line 52 "parser.y"
-                        {(yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); optimize_ast((yyvsp[0].a)); eval((yyvsp[0].a));  }
-#line 1532 "parser.tab.c"
+  case 15: /* START: START stmts  */
+#line 87 "parser.y"
+                        {(yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); optimize_ast((yyvsp[0].a)); resolve_unit((yyvsp[0].a)); execute((yyvsp[0].a));  }
+#line 1648 "parser.tab.c"
     break;
 
-  case 5: /* START: START ufunction  */
-#line 53 "parser.y"
-                        { (yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); optimize_ast((yyvsp[0].a)); eval((yyvsp[0].a)); }
-#line 1538 "parser.tab.c"
+  case 16: /* START: START ufunction  */
+#line 88 "parser.y"
+                        { (yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a)); optimize_ast((yyvsp[0].a)); resolve_unit((yyvsp[0].a)); execute((yyvsp[0].a)); }
+#line 1654 "parser.tab.c"
     break;
 
-  case 6: /* START: START error  */
-#line 54 "parser.y"
-                        { yyerrok; printf("> "); }
-#line 1544 "parser.tab.c"
+  case 17: /* START: START error  */
+#line 89 "parser.y"
+                        { yyerrok; arena_free(arena_end()); printf("> "); }
+#line 1660 "parser.tab.c"
     break;
 
-  case 7: /* START: START  */
-#line 55 "parser.y"
+  case 18: /* START: START  */
+#line 90 "parser.y"
                         { printf("> "); (yyval.a) = (yyvsp[0].a); }
-#line 1550 "parser.tab.c"
+#line 1666 "parser.tab.c"
     break;
 
-  case 8: /* stmts: stmt ';' stmts  */
-#line 58 "parser.y"
+  case 19: /* stmts: stmt ';' stmts  */
+#line 93 "parser.y"
                     { if ((yyvsp[0].a) == NULL) 
         (yyval.a) = (yyvsp[-2].a);
     else 
         (yyval.a) = newast('L', (yyvsp[-2].a), (yyvsp[0].a)); 
         }
-#line 1560 "parser.tab.c"
+#line 1676 "parser.tab.c"
     break;
 
-  case 9: /* stmts: stmt ';'  */
-#line 63 "parser.y"
+  case 20: /* stmts: stmt ';'  */
+#line 98 "parser.y"
                { (yyval.a) = (yyvsp[-1].a); }
-#line 1566 "parser.tab.c"
+#line 1682 "parser.tab.c"
     break;
 
-  case 10: /* stmts: flow stmts  */
-#line 64 "parser.y"
+  case 21: /* stmts: flow stmts  */
+#line 99 "parser.y"
                  {  
         if ((yyvsp[0].a) == NULL) 
             (yyval.a) = (yyvsp[-1].a);
         else 
             (yyval.a) = newast('L', (yyvsp[-1].a), (yyvsp[0].a));
     }
-#line 1577 "parser.tab.c"
+#line 1693 "parser.tab.c"
     break;
 
-  case 11: /* stmts: flow  */
-#line 70 "parser.y"
+  case 22: /* stmts: flow  */
+#line 105 "parser.y"
             { (yyval.a) = (yyvsp[0].a); }
-#line 1583 "parser.tab.c"
+#line 1699 "parser.tab.c"
     break;
 
-  case 12: /* stmt: declare  */
-#line 73 "parser.y"
+  case 23: /* stmt: declare  */
+#line 108 "parser.y"
                     { (yyval.a) = (yyvsp[0].a); }
-#line 1589 "parser.tab.c"
+#line 1705 "parser.tab.c"
     break;
 
-  case 13: /* stmt: assignment  */
-#line 74 "parser.y"
+  case 24: /* stmt: assignment  */
+#line 109 "parser.y"
                     { (yyval.a) = (yyvsp[0].a); }
-#line 1595 "parser.tab.c"
+#line 1711 "parser.tab.c"
     break;
 
-  case 14: /* stmt: funcall  */
-#line 75 "parser.y"
+  case 25: /* stmt: funcall  */
+#line 110 "parser.y"
                     { (yyval.a) = (yyvsp[0].a); }
-#line 1601 "parser.tab.c"
+#line 1717 "parser.tab.c"
     break;
 
-  case 15: /* stmt: return  */
-#line 76 "parser.y"
+  case 26: /* stmt: return  */
+#line 111 "parser.y"
                     { (yyval.a) = (yyvsp[0].a); }
-#line 1607 "parser.tab.c"
+#line 1723 "parser.tab.c"
     break;
 
-  case 16: /* stmt: expr  */
-#line 77 "parser.y"
+  case 27: /* stmt: expr  */
+#line 112 "parser.y"
                     { (yyval.a) = (yyvsp[0].a); }
-#line 1613 "parser.tab.c"
+#line 1729 "parser.tab.c"
     break;
 
-  case 20: /* declare: DATA_TYPE ID init  */
-#line 84 "parser.y"
+  case 31: /* declare: DATA_TYPE ID init  */
+#line 119 "parser.y"
                            {
         struct ast *declare = newdeclare((yyvsp[-1].s));
         (yyvsp[-1].s)->type = (yyvsp[-2].dt);
         struct ast *assign = newasgn((yyvsp[-1].s), (yyvsp[0].a));
         (yyval.a) = newast('L', declare, assign);
     }
-#line 1624 "parser.tab.c"
+#line 1740 "parser.tab.c"
     break;
 
-  case 21: /* init: ASSIGN expr  */
-#line 91 "parser.y"
+  case 32: /* init: ASSIGN expr  */
+#line 126 "parser.y"
                   { (yyval.a) = (yyvsp[0].a); }
-#line 1630 "parser.tab.c"
+#line 1746 "parser.tab.c"
     break;
 
-  case 22: /* init: %empty  */
-#line 92 "parser.y"
+  case 33: /* init: %empty  */
+#line 127 "parser.y"
       { (yyval.a) = NULL; }
-#line 1636 "parser.tab.c"
+#line 1752 "parser.tab.c"
     break;
 
-  case 23: /* assignment: ID ASSIGN expr  */
-#line 94 "parser.y"
+  case 34: /* assignment: ID ASSIGN expr  */
+#line 129 "parser.y"
                            { (yyval.a) = newasgn((yyvsp[-2].s), (yyvsp[0].a)); }
-#line 1642 "parser.tab.c"
+#line 1758 "parser.tab.c"
     break;
 
-  case 24: /* whether: WHETHER '[' condition ']' THEN ':' '{' stmts '}'  */
-#line 96 "parser.y"
+  case 35: /* whether: WHETHER '[' condition ']' THEN ':' '{' stmts '}'  */
+#line 131 "parser.y"
                                                                                   { (yyval.a) = newflow('I', (yyvsp[-6].a), (yyvsp[-1].a), NULL); }
-#line 1648 "parser.tab.c"
+#line 1764 "parser.tab.c"
     break;
 
-  case 25: /* whether: WHETHER '[' condition ']' THEN ':' '{' stmts '}' OTHERWISE ':' '{' stmts '}'  */
-#line 97 "parser.y"
+  case 36: /* whether: WHETHER '[' condition ']' THEN ':' '{' stmts '}' OTHERWISE ':' '{' stmts '}'  */
+#line 132 "parser.y"
                                                                                   { (yyval.a) = newflow('I', (yyvsp[-11].a), (yyvsp[-6].a), (yyvsp[-1].a)); }
-#line 1654 "parser.tab.c"
+#line 1770 "parser.tab.c"
     break;
 
-  case 26: /* when: WHEN '[' condition ']' '{' stmts '}'  */
-#line 100 "parser.y"
+  case 37: /* when: WHEN '[' condition ']' '{' stmts '}'  */
+#line 135 "parser.y"
                                                     { (yyval.a) = newflow('W', (yyvsp[-4].a), (yyvsp[-1].a), NULL); }
-#line 1660 "parser.tab.c"
+#line 1776 "parser.tab.c"
     break;
 
-  case 27: /* when: WHEN '{' stmts '}' UNTIL '[' condition ']'  */
-#line 101 "parser.y"
+  case 38: /* when: WHEN '{' stmts '}' UNTIL '[' condition ']'  */
+#line 136 "parser.y"
                                                     { (yyval.a) = newflow('W', (yyvsp[-1].a), (yyvsp[-5].a), (yyvsp[-1].a)); }
-#line 1666 "parser.tab.c"
+#line 1782 "parser.tab.c"
     break;
 
-  case 28: /* from: FROM '[' declare TO expr STEP expr ']' '{' stmts '}'  */
-#line 106 "parser.y"
+  case 39: /* from: FROM parallel '[' declare TO expr STEP expr ']' reductions '{' stmts '}'  */
+#line 141 "parser.y"
      {
-         struct ast *add = newast('+', newref((yyvsp[-8].a)->l->data.sym), (yyvsp[-4].a));
-         struct ast *ass = newasgn((yyvsp[-8].a)->l->data.sym, add);
-         struct ast *cmp = newast('6', newref((yyvsp[-8].a)->l->data.sym), (yyvsp[-6].a));
-         (yyval.a) = newfor((yyvsp[-8].a), cmp, ass, (yyvsp[-1].a));
+         if (!(yyvsp[-11].s) && (yyvsp[-3].a)) {
+             yyerror("syntax error, reductions of a from that is not parallel");
+             YYERROR;
+         }
+         struct ast *add = newast('+', newref((yyvsp[-9].a)->l->data.sym), (yyvsp[-5].a));
+         struct ast *ass = newasgn((yyvsp[-9].a)->l->data.sym, add);
+         struct ast *cmp = newast('6', newref((yyvsp[-9].a)->l->data.sym), (yyvsp[-7].a));
+         (yyval.a) = (yyvsp[-11].s) ? newparfor((yyvsp[-9].a), cmp, ass, (yyvsp[-1].a), (yyvsp[-3].a)) : newfor((yyvsp[-9].a), cmp, ass, (yyvsp[-1].a));
      }
-#line 1677 "parser.tab.c"
+#line 1797 "parser.tab.c"
+    break;
+
+  case 40: /* parallel: %empty  */
+#line 155 "parser.y"
+                        { (yyval.s) = NULL; }
+#line 1803 "parser.tab.c"
+    break;
+
+  case 41: /* parallel: ID  */
+#line 156 "parser.y"
+         {
+        if (strcasecmp((yyvsp[0].s)->name, "parallel")) {
+            yyerror("syntax error, unexpected %s after from", (yyvsp[0].s)->name);
+            YYERROR;
+        }
+        (yyval.s) = (yyvsp[0].s);
+    }
+#line 1815 "parser.tab.c"
+    break;
+
+  case 42: /* reductions: %empty  */
+#line 166 "parser.y"
+                                { (yyval.a) = NULL; }
+#line 1821 "parser.tab.c"
+    break;
+
+  case 43: /* reductions: '[' reducelist ']'  */
+#line 167 "parser.y"
+                                { (yyval.a) = (yyvsp[-1].a); }
+#line 1827 "parser.tab.c"
+    break;
+
+  case 45: /* reducelist: reduction ',' reducelist  */
+#line 170 "parser.y"
+                                { (yyval.a) = newast('[', (yyvsp[-2].a), (yyvsp[0].a)); }
+#line 1833 "parser.tab.c"
+    break;
+
+  case 46: /* reduction: ID PLUS  */
+#line 172 "parser.y"
+                    { (yyval.a) = newast('+', newref((yyvsp[-1].s)), NULL); }
+#line 1839 "parser.tab.c"
     break;
 
-  case 29: /* condition: expr CMP expr  */
-#line 113 "parser.y"
+  case 47: /* reduction: ID ID  */
+#line 173 "parser.y"
+            {
+        if (!strcasecmp((yyvsp[0].s)->name, "min")) {
+            (yyval.a) = newast('2', newref((yyvsp[-1].s)), NULL);
+        } else if (!strcasecmp((yyvsp[0].s)->name, "max")) {
+            (yyval.a) = newast('1', newref((yyvsp[-1].s)), NULL);
+        } else {
+            yyerror("syntax error, unknown reduction %s of %s", (yyvsp[0].s)->name, (yyvsp[-1].s)->name);
+            YYERROR;
+        }
+    }
+#line 1854 "parser.tab.c"
+    break;
+
+  case 48: /* condition: expr CMP expr  */
+#line 184 "parser.y"
                                 { (yyval.a) = newcmp((yyvsp[-1].fn), (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1683 "parser.tab.c"
+#line 1860 "parser.tab.c"
     break;
 
-  case 30: /* condition: condition AND condition  */
-#line 114 "parser.y"
+  case 49: /* condition: condition AND condition  */
+#line 185 "parser.y"
                                 { (yyval.a) = newast('&', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1689 "parser.tab.c"
+#line 1866 "parser.tab.c"
     break;
 
-  case 31: /* condition: condition OR condition  */
-#line 115 "parser.y"
+  case 50: /* condition: condition OR condition  */
+#line 186 "parser.y"
                                 { (yyval.a) = newast('O', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1695 "parser.tab.c"
+#line 1872 "parser.tab.c"
     break;
 
-  case 32: /* condition: NOT condition  */
-#line 116 "parser.y"
+  case 51: /* condition: NOT condition  */
+#line 187 "parser.y"
                                 { (yyval.a) = newast('!', (yyvsp[0].a), NULL); }
-#line 1701 "parser.tab.c"
+#line 1878 "parser.tab.c"
     break;
 
-  case 33: /* condition: '(' condition ')'  */
-#line 117 "parser.y"
+  case 52: /* condition: '(' condition ')'  */
+#line 188 "parser.y"
                                 { (yyval.a) = (yyvsp[-1].a); }
-#line 1707 "parser.tab.c"
+#line 1884 "parser.tab.c"
     break;
 
-  case 34: /* condition: expr  */
-#line 118 "parser.y"
+  case 53: /* condition: expr  */
+#line 189 "parser.y"
                                 { (yyval.a) = (yyvsp[0].a); }
-#line 1713 "parser.tab.c"
+#line 1890 "parser.tab.c"
     break;
 
-  case 35: /* expr: expr PLUS expr  */
-#line 120 "parser.y"
+  case 54: /* expr: expr PLUS expr  */
+#line 191 "parser.y"
                                 { (yyval.a) = newast('+', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1719 "parser.tab.c"
+#line 1896 "parser.tab.c"
     break;
 
-  case 36: /* expr: expr MINUS expr  */
-#line 121 "parser.y"
+  case 55: /* expr: expr MINUS expr  */
+#line 192 "parser.y"
                                 { (yyval.a) = newast('-', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1725 "parser.tab.c"
+#line 1902 "parser.tab.c"
     break;
 
-  case 37: /* expr: expr MUL expr  */
-#line 122 "parser.y"
+  case 56: /* expr: expr MUL expr  */
+#line 193 "parser.y"
                                 { (yyval.a) = newast('*', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1731 "parser.tab.c"
+#line 1908 "parser.tab.c"
     break;
 
-  case 38: /* expr: expr DIV expr  */
-#line 123 "parser.y"
+  case 57: /* expr: expr DIV expr  */
+#line 194 "parser.y"
                                 { (yyval.a) = newast('/', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1737 "parser.tab.c"
+#line 1914 "parser.tab.c"
     break;
 
-  case 39: /* expr: expr POW expr  */
-#line 124 "parser.y"
+  case 58: /* expr: expr POW expr  */
+#line 195 "parser.y"
                                 { (yyval.a) = newast('^', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1743 "parser.tab.c"
+#line 1920 "parser.tab.c"
     break;
 
-  case 40: /* expr: expr MOD expr  */
-#line 125 "parser.y"
+  case 59: /* expr: expr MOD expr  */
+#line 196 "parser.y"
                                 { (yyval.a) = newast('%', (yyvsp[-2].a),(yyvsp[0].a)); }
-#line 1749 "parser.tab.c"
+#line 1926 "parser.tab.c"
     break;
 
-  case 41: /* expr: ABS expr ABS  */
-#line 126 "parser.y"
+  case 60: /* expr: ABS expr ABS  */
+#line 197 "parser.y"
                                 { (yyval.a) = newast('|', (yyvsp[-1].a), NULL); }
-#line 1755 "parser.tab.c"
+#line 1932 "parser.tab.c"
     break;
 
-  case 42: /* expr: MINUS expr  */
-#line 127 "parser.y"
+  case 61: /* expr: MINUS expr  */
+#line 198 "parser.y"
                                 { (yyval.a) = newast('M', (yyvsp[0].a), NULL); }
-#line 1761 "parser.tab.c"
+#line 1938 "parser.tab.c"
     break;
 
-  case 43: /* expr: '(' expr ')'  */
-#line 128 "parser.y"
+  case 62: /* expr: '(' expr ')'  */
+#line 199 "parser.y"
                                 { (yyval.a) = (yyvsp[-1].a); }
-#line 1767 "parser.tab.c"
+#line 1944 "parser.tab.c"
     break;
 
-  case 44: /* expr: value  */
-#line 129 "parser.y"
+  case 63: /* expr: value  */
+#line 200 "parser.y"
                                 { (yyval.a) = (yyvsp[0].a); }
-#line 1773 "parser.tab.c"
+#line 1950 "parser.tab.c"
     break;
 
-  case 45: /* expr: funcall  */
-#line 130 "parser.y"
+  case 64: /* expr: funcall  */
+#line 201 "parser.y"
                                 { (yyval.a) = (yyvsp[0].a); }
-#line 1779 "parser.tab.c"
+#line 1956 "parser.tab.c"
     break;
 
-  case 46: /* value: %empty  */
-#line 132 "parser.y"
-                {(yyval.a) = NULL;}
-#line 1785 "parser.tab.c"
+  case 65: /* value: %empty  */
+#line 203 "parser.y"
+                   {(yyval.a) = NULL;}
+#line 1962 "parser.tab.c"
     break;
 
-  case 47: /* value: NUM  */
-#line 133 "parser.y"
+  case 66: /* value: NUM  */
+#line 204 "parser.y"
                 { (yyval.a) = newnum((yyvsp[0].num));}
-#line 1791 "parser.tab.c"
+#line 1968 "parser.tab.c"
     break;
 
-  case 48: /* value: BINARY  */
-#line 134 "parser.y"
+  case 67: /* value: BINARY  */
+#line 205 "parser.y"
                 { (yyval.a) = newnum((yyvsp[0].num)); }
-#line 1797 "parser.tab.c"
+#line 1974 "parser.tab.c"
     break;
 
-  case 49: /* value: ROMAN  */
-#line 135 "parser.y"
+  case 68: /* value: ROMAN  */
+#line 206 "parser.y"
                 { (yyval.a) = newnum((yyvsp[0].num)); }
-#line 1803 "parser.tab.c"
+#line 1980 "parser.tab.c"
     break;
 
-  case 50: /* value: ID  */
-#line 136 "parser.y"
+  case 69: /* value: ID  */
+#line 207 "parser.y"
                 { (yyval.a) = newref((yyvsp[0].s)); }
-#line 1809 "parser.tab.c"
+#line 1986 "parser.tab.c"
     break;
 
-  case 51: /* value: STR  */
-#line 137 "parser.y"
-                { (yyval.a) = newstr((yyvsp[0].st)); }
-#line 1815 "parser.tab.c"
+  case 70: /* value: STR  */
+#line 208 "parser.y"
+                { (yyval.a) = newstr((yyvsp[0].st).s, (yyvsp[0].st).length); }
+#line 1992 "parser.tab.c"
     break;
 
-  case 52: /* value: list  */
-#line 138 "parser.y"
+  case 71: /* value: list  */
+#line 209 "parser.y"
                 { (yyval.a) = (yyvsp[0].a); }
-#line 1821 "parser.tab.c"
+#line 1998 "parser.tab.c"
     break;
 
-  case 53: /* list: '[' ']'  */
-#line 140 "parser.y"
+  case 72: /* list: '[' ']'  */
+#line 211 "parser.y"
                       { (yyval.a) = NULL; }
-#line 1827 "parser.tab.c"
+#line 2004 "parser.tab.c"
     break;
 
-  case 54: /* list: '[' explist ']'  */
-#line 141 "parser.y"
+  case 73: /* list: '[' explist ']'  */
+#line 212 "parser.y"
                       { (yyval.a) = (yyvsp[-1].a); }
-#line 1833 "parser.tab.c"
+#line 2010 "parser.tab.c"
     break;
 
-  case 56: /* explist: expr ',' explist  */
-#line 145 "parser.y"
+  case 75: /* explist: expr ',' explist  */
+#line 216 "parser.y"
                        { (yyval.a) = newast('[', (yyvsp[-2].a), (yyvsp[0].a)); }
-#line 1839 "parser.tab.c"
+#line 2016 "parser.tab.c"
     break;
 
-  case 57: /* symlist: ID  */
-#line 147 "parser.y"
+  case 76: /* symlist: ID  */
+#line 218 "parser.y"
                      { (yyval.sl) = newsymlist((yyvsp[0].s), NULL); }
-#line 1845 "parser.tab.c"
+#line 2022 "parser.tab.c"
     break;
 
-  case 58: /* symlist: ID ',' symlist  */
-#line 148 "parser.y"
+  case 77: /* symlist: ID ',' symlist  */
+#line 219 "parser.y"
                      { (yyval.sl) = newsymlist((yyvsp[-2].s), (yyvsp[0].sl)); }
-#line 1851 "parser.tab.c"
+#line 2028 "parser.tab.c"
     break;
 
-  case 59: /* return: RETURN expr  */
-#line 150 "parser.y"
+  case 78: /* return: RETURN expr  */
+#line 221 "parser.y"
                      { (yyval.a) = newast('R', (yyvsp[0].a), NULL); }
-#line 1857 "parser.tab.c"
+#line 2034 "parser.tab.c"
     break;
 
-  case 60: /* ufunction: DEFINE ID '(' symlist ')' '{' stmts '}'  */
-#line 152 "parser.y"
-                                                    { dodef((yyvsp[-6].s),(yyvsp[-4].sl),(yyvsp[-1].a)); (yyval.a) = newdeclare((yyvsp[-6].s));/* printf("Function %s defined\n", $2->name);*/ }
-#line 1863 "parser.tab.c"
+  case 79: /* ufunction: define ID '(' symlist ')' '{' stmts '}'  */
+#line 223 "parser.y"
+                                                    { if (reserved((yyvsp[-6].s)->name)) YYERROR; dodef((yyvsp[-6].s),(yyvsp[-4].sl),(yyvsp[-1].a)); (yyval.a) = newdeclare((yyvsp[-6].s));/* printf("Function %s defined\n", $2->name);*/ }
+#line 2040 "parser.tab.c"
     break;
 
-  case 61: /* ufunction: DEFINE ID '(' ')' '{' stmts '}'  */
-#line 153 "parser.y"
-                                                    { dodef((yyvsp[-5].s),NULL,(yyvsp[-1].a)); (yyval.a) = newdeclare((yyvsp[-5].s)); /*printf("Function %s defined\n", $2->name);*/ }
-#line 1869 "parser.tab.c"
+  case 80: /* ufunction: define ID '(' ')' '{' stmts '}'  */
+#line 224 "parser.y"
+                                                    { if (reserved((yyvsp[-5].s)->name)) YYERROR; dodef((yyvsp[-5].s),NULL,(yyvsp[-1].a)); (yyval.a) = newdeclare((yyvsp[-5].s)); /*printf("Function %s defined\n", $2->name);*/ }
+#line 2046 "parser.tab.c"
     break;
 
-  case 62: /* funcall: ID '(' explist ')'  */
-#line 155 "parser.y"
-                            { (yyval.a) = newcall((yyvsp[-3].s), (yyvsp[-1].a)); }
-#line 1875 "parser.tab.c"
+  case 81: /* define: DEFINE  */
+#line 226 "parser.y"
+               { arena_begin(); }
+#line 2052 "parser.tab.c"
     break;
 
-  case 63: /* funcall: FUNC '(' explist ')'  */
-#line 156 "parser.y"
+  case 82: /* funcall: ID '(' explist ')'  */
+#line 229 "parser.y"
+    {
+        int f = function_builtin((yyvsp[-3].s)->name, (yyvsp[-1].a));
+        if (f < 0) YYERROR;
+        (yyval.a) = f ? newfunc(f, (yyvsp[-1].a)) : newcall((yyvsp[-3].s), (yyvsp[-1].a));
+    }
+#line 2062 "parser.tab.c"
+    break;
+
+  case 83: /* funcall: FUNC '(' explist ')'  */
+#line 234 "parser.y"
                             { (yyval.a) = newfunc((yyvsp[-3].fn), (yyvsp[-1].a)); }
-#line 1881 "parser.tab.c"
+#line 2068 "parser.tab.c"
+    break;
+
+  case 84: /* funcall: ID funcall  */
+#line 237 "parser.y"
+    {
+        if (strcasecmp((yyvsp[-1].s)->name, "spawn")) {
+            yyerror("syntax error, unexpected call after %s", (yyvsp[-1].s)->name);
+            YYERROR;
+        }
+        if ((yyvsp[0].a)->nodetype != 'C') {
+            yyerror("syntax error, spawn takes a call of a function defined with define");
+            YYERROR;
+        }
+        (yyval.a) = newast('A', (yyvsp[0].a), NULL);
+    }
+#line 2084 "parser.tab.c"
     break;
 
 
-#line 1885 "parser.tab.c"
+#line 2088 "parser.tab.c"
 
       default: break;
     }
@@ -2105,24 +2308,92 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 159 "parser.y"
+#line 250 "parser.y"
 
 
-int main(int argc, char **argv) {
-
-    if(argc < 2) { /* just read stdin */
-        yyparse();
-        return 0;
+#undef yylex
+static int next_token(YYSTYPE *lval) {
+    if (ctx->start_token) {
+        int t = ctx->start_token;
+        ctx->start_token = 0;
+        return t;
     }
-    for(int i = 1; i < argc; i++) {
-        FILE *f = fopen(argv[i], "r");
-        if(!f) {
-            perror(argv[i]);
-            return (1);
-        }
-        yyin = f;
-        yyparse();
-        fclose(f);
+    return yylex(lval, ctx->scanner);
+}
+
+/* Built-ins that are not keywords, the names are recognized here so that
+   they can still name variables, but not functions, see reserved(): map,
+   filter and reduce take a function, named by their second argument,
+   await the number of a task. Returns the built-in named name, 0 for the
+   other names */
+static int builtin_name(char *name) {
+    return !strcasecmp(name, "map") ? B_map : !strcasecmp(name, "filter") ? B_filter :
+           !strcasecmp(name, "reduce") ? B_reduce : !strcasecmp(name, "await") ? B_await : 0;
+}
+
+/* the built-in called name with args, 0 for the other names and -1 after
+   reporting arguments that do not fit, none at all included */
+static int function_builtin(char *name, struct ast *args) {
+    int f = builtin_name(name);
+    struct ast *rest = args && args->nodetype == '[' ? args->r : NULL;
+    int fits;
+
+    if (!f) return 0;
+    if (f == B_await)
+        fits = args && args->nodetype != '[';
+    else if (f == B_reduce)
+        fits = rest && args->l && rest->nodetype == '[' && rest->l && rest->l->nodetype == 'N' &&
+               (!rest->r || rest->r->nodetype != '[');
+    else
+        fits = rest && args->l && rest->nodetype == 'N';
+    if (fits) return f;
+    if (f == B_await)
+        yyerror("syntax error, await() expects a task");
+    else
+        yyerror("syntax error, %s() expects a list, a function name%s", name,
+                f == B_reduce ? " and an initial value" : "");
+    return -1;
+}
+
+/* a call to one of the names of function_builtin() always calls the
+   built-in, so a function of that name could never be called */
+static int reserved(char *name) {
+    if (!builtin_name(name)) return 0;
+    yyerror("syntax error, %s is a built-in function and cannot be defined", name);
+    return 1;
+}
+
+/* The lookahead token may already have been read into the nodes of the
+   program arena, so the arena of a statement is freed with the next one */
+static void run_statement(struct ast *a) {
+    optimize_ast(a);
+    resolve_unit(a);
+    execute(a);
+    arena_free(ctx->previous);
+    ctx->previous = arena_take();
+}
+
+/* parse and run f in the context of the thread */
+void run_file(FILE *f, int stream) {
+    yyset_in(f, ctx->scanner);
+    if(stream) {
+        ctx->start_token = STREAM;
+        interactive_input(1, ctx->scanner);
+    } else if(f != stdin) {
+        map_input(f, ctx->scanner);
     }
-    return 0;
+    yyparse();
+    unmap_input(ctx->scanner);
+}
+
+/* parse the input of the scanner of the context without running it: the
+   tree of its top level statements, NULL when there are none. The tree
+   is optimized and resolved, ready for execute() */
+struct ast *parse_program() {
+    ctx->start_token = COMPILE;
+    ctx->parsed = NULL;
+    yyparse();
+    optimize_ast(ctx->parsed);
+    resolve_unit(ctx->parsed);
+    return ctx->parsed;
 }
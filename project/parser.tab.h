@@ -82,8 +82,11 @@ extern int yydebug;
     FUNC = 283,                    /* FUNC  */
     DATA_TYPE = 284,               /* DATA_TYPE  */
     ID = 285,                      /* ID  */
-    CMP = 286,                     /* CMP  */
-    UMINUS = 287                   /* UMINUS  */
+    STREAM = 286,                  /* STREAM  */
+    COMPILE = 287,                 /* COMPILE  */
+    EMPTY = 288,                   /* EMPTY  */
+    CMP = 289,                     /* CMP  */
+    UMINUS = 290                   /* UMINUS  */
   };
   typedef enum yytokentype yytoken_kind_t;
 #endif
@@ -92,10 +95,10 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 19 "parser.y"
+#line 23 "parser.y"
 
     double num;
-    char *st;
+    struct { char *s; size_t length; } st; // string literal, not terminated
     char *op;
     struct ast *a;
     struct symbol *s;   // which symbol
@@ -103,7 +106,7 @@ union YYSTYPE
     int fn;             // which function
     int dt;             // which data type
 
-#line 107 "parser.tab.h"
+#line 110 "parser.tab.h"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -112,7 +115,6 @@ typedef union YYSTYPE YYSTYPE;
 #endif
 
 
-extern YYSTYPE yylval;
 
 
 int yyparse (void);
@@ -2,23 +2,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
 #include "helper.h"
 
 int yydebug = 1;
-extern FILE *yyin;
-extern int yylineno;
 
 void print_val(val_t val);
 
-int yylex();
+static void run_statement(struct ast *a);
+static int function_builtin(char *name, struct ast *args);
+static int reserved(char *name);
 %}
 
+/* The parser keeps its state on the stack and the scanner is the one of
+   the context, so that each thread can parse a script of its own */
+%define api.pure full
 %define parse.error verbose
 //union declares types to be used in the values of symbols in the parser
 %union {
     double num;
-    char *st;
+    struct { char *s; size_t length; } st; // string literal, not terminated
     char *op;
     struct ast *a;
     struct symbol *s;   // which symbol
@@ -34,24 +38,55 @@ int yylex();
 %token <fn> FUNC 
 %token <dt> DATA_TYPE
 %token <s> ID
+%token STREAM COMPILE
 
-%type <a> expr stmt stmts whether when condition explist assignment return flow ufunction funcall START declare init value from list
+%type <a> program expr stmt stmts whether when condition explist assignment return flow ufunction funcall START declare init value from list reductions reducelist reduction
 %type <sl> symlist
+%type <s> parallel
 
+%nonassoc EMPTY   /* below every operator: - after an empty value is unary */
 %nonassoc <fn> CMP
 %right ASSIGN
 %left PLUS MINUS POW
 %left MUL DIV MOD
 %nonassoc ABS UMINUS
 
+%code {
+int yylex(YYSTYPE *lval, yyscan_t scanner);
+
+/* --stream and parse_program(): the first token the parser gets,
+   ctx->start_token, selects the stream or the program rules */
+static int next_token(YYSTYPE *lval);
+#define yylex next_token
+}
+
 %start S
 %%
-S: START { print_ast($1, 0, " ");  } 
+S: START { save_program($1); print_ast($1, 0, " "); arena_free_program(); } 
+    | STREAM stream
+    | COMPILE program   { ctx->parsed = $2; }
+    ;
+/* --stream: each top level statement runs and is released as soon as it
+   is parsed, the tree of the script is not kept. After an error the input
+   is skipped up to the next ';' */
+stream: /* nothing */
+    | stream stmt ';'   { run_statement($2); }
+    | stream flow       { run_statement($2); }
+    | stream ufunction  { run_statement($2); }
+    | stream error ';'  { yyerrok; arena_free(arena_end()); }
+    ;
+
+/* parse_program(): the statements are kept to be run later, not run */
+program: /* nothing */      { $$ = NULL; }
+    | program stmt ';'      { $$ = newast('L', $1, $2); }
+    | program flow          { $$ = newast('L', $1, $2); }
+    | program ufunction     { $$ = newast('L', $1, $2); }
+    ;
 
 START: /* nothing */    { $$ = NULL; }
-    | START stmts       {$$ = newast('L', $1, $2); optimize_ast($2); eval($2);  }
-    | START ufunction   { $$ = newast('L', $1, $2); optimize_ast($2); eval($2); }
-    | START error       { yyerrok; printf("> "); }
+    | START stmts       {$$ = newast('L', $1, $2); optimize_ast($2); resolve_unit($2); execute($2);  }
+    | START ufunction   { $$ = newast('L', $1, $2); optimize_ast($2); resolve_unit($2); execute($2); }
+    | START error       { yyerrok; arena_free(arena_end()); printf("> "); }
     | START             { printf("> "); $$ = $1; }
     ;
 stmts: 
@@ -102,14 +137,50 @@ when: WHEN '[' condition ']'  '{' stmts '}'         { $$ = newflow('W', $3, $6,
     ;
 
 /* from works only if you declare the variable in the from statement */
-from: FROM '[' declare TO expr STEP expr ']' '{' stmts '}'
+from: FROM parallel '[' declare TO expr STEP expr ']' reductions '{' stmts '}'
      {
-         struct ast *add = newast('+', newref($3->l->data.sym), $7);
-         struct ast *ass = newasgn($3->l->data.sym, add);
-         struct ast *cmp = newast('6', newref($3->l->data.sym), $5);
-         $$ = newfor($3, cmp, ass, $10);
+         if (!$2 && $10) {
+             yyerror("syntax error, reductions of a from that is not parallel");
+             YYERROR;
+         }
+         struct ast *add = newast('+', newref($4->l->data.sym), $8);
+         struct ast *ass = newasgn($4->l->data.sym, add);
+         struct ast *cmp = newast('6', newref($4->l->data.sym), $6);
+         $$ = $2 ? newparfor($4, cmp, ass, $12, $10) : newfor($4, cmp, ass, $12);
      } 
      ;
+/* from parallel: the iterations may run on several threads, see
+   parallel.c. parallel is not a keyword, it can still name a variable.
+   One rule for both forms of from, so that they share their states */
+parallel: /* nothing */ { $$ = NULL; }
+    | ID {
+        if (strcasecmp($1->name, "parallel")) {
+            yyerror("syntax error, unexpected %s after from", $1->name);
+            YYERROR;
+        }
+        $$ = $1;
+    }
+    ;
+/* variables the iterations of a parallel from add to (s +), or keep the
+   least (m min) or the greatest (m max) value in */
+reductions: /* nothing */       { $$ = NULL; }
+    | '[' reducelist ']'        { $$ = $2; }
+    ;
+reducelist: reduction
+    | reduction ',' reducelist  { $$ = newast('[', $1, $3); }
+    ;
+reduction: ID PLUS  { $$ = newast('+', newref($1), NULL); }
+    | ID ID {
+        if (!strcasecmp($2->name, "min")) {
+            $$ = newast('2', newref($1), NULL);
+        } else if (!strcasecmp($2->name, "max")) {
+            $$ = newast('1', newref($1), NULL);
+        } else {
+            yyerror("syntax error, unknown reduction %s of %s", $2->name, $1->name);
+            YYERROR;
+        }
+    }
+    ;
 condition: expr CMP expr        { $$ = newcmp($2, $1, $3); }
     | condition AND condition   { $$ = newast('&', $1, $3); }
     | condition OR condition    { $$ = newast('O', $1, $3); }
@@ -129,12 +200,12 @@ expr: expr PLUS expr            { $$ = newast('+', $1, $3); }
     | value                     { $$ = $1; }
     | funcall                   { $$ = $1; }
     ;
-value:          {$$ = NULL;}
+value: %prec EMPTY {$$ = NULL;}
     | NUM       { $$ = newnum($1);}
     | BINARY    { $$ = newnum($1); }
     | ROMAN     { $$ = newnum($1); }
     | ID        { $$ = newref($1); }
-    | STR       { $$ = newstr($1); }
+    | STR       { $$ = newstr($1.s, $1.length); }
     | list      { $$ = $1; }
     ;
 list: '[' ']'         { $$ = NULL; } 
@@ -149,30 +220,118 @@ symlist: ID          { $$ = newsymlist($1, NULL); }
     ;
 return: RETURN expr  { $$ = newast('R', $2, NULL); } 
     ;
-ufunction: DEFINE  ID '(' symlist ')' '{' stmts '}' { dodef($2,$4,$7); $$ = newdeclare($2);/* printf("Function %s defined\n", $2->name);*/ }
-    | DEFINE  ID '('  ')' '{' stmts '}'             { dodef($2,NULL,$6); $$ = newdeclare($2); /*printf("Function %s defined\n", $2->name);*/ }
+ufunction: define  ID '(' symlist ')' '{' stmts '}' { if (reserved($2->name)) YYERROR; dodef($2,$4,$7); $$ = newdeclare($2);/* printf("Function %s defined\n", $2->name);*/ }
+    | define  ID '('  ')' '{' stmts '}'             { if (reserved($2->name)) YYERROR; dodef($2,NULL,$6); $$ = newdeclare($2); /*printf("Function %s defined\n", $2->name);*/ }
     ;
-funcall: ID '(' explist ')' { $$ = newcall($1, $3); }
+define: DEFINE { arena_begin(); } /* the body gets an arena of its own */
+    ;
+funcall: ID '(' explist ')'
+    {
+        int f = function_builtin($1->name, $3);
+        if (f < 0) YYERROR;
+        $$ = f ? newfunc(f, $3) : newcall($1, $3);
+    }
     | FUNC '(' explist ')'  { $$ = newfunc($1, $3); }
+    /* spawn f(...): f runs as a task, see parallel.c. spawn is not a keyword */
+    | ID funcall
+    {
+        if (strcasecmp($1->name, "spawn")) {
+            yyerror("syntax error, unexpected call after %s", $1->name);
+            YYERROR;
+        }
+        if ($2->nodetype != 'C') {
+            yyerror("syntax error, spawn takes a call of a function defined with define");
+            YYERROR;
+        }
+        $$ = newast('A', $2, NULL);
+    }
     ;
 
 %%
 
-int main(int argc, char **argv) {
-
-    if(argc < 2) { /* just read stdin */
-        yyparse();
-        return 0;
+#undef yylex
+static int next_token(YYSTYPE *lval) {
+    if (ctx->start_token) {
+        int t = ctx->start_token;
+        ctx->start_token = 0;
+        return t;
     }
-    for(int i = 1; i < argc; i++) {
-        FILE *f = fopen(argv[i], "r");
-        if(!f) {
-            perror(argv[i]);
-            return (1);
-        }
-        yyin = f;
-        yyparse();
-        fclose(f);
+    return yylex(lval, ctx->scanner);
+}
+
+/* Built-ins that are not keywords, the names are recognized here so that
+   they can still name variables, but not functions, see reserved(): map,
+   filter and reduce take a function, named by their second argument,
+   await the number of a task. Returns the built-in named name, 0 for the
+   other names */
+static int builtin_name(char *name) {
+    return !strcasecmp(name, "map") ? B_map : !strcasecmp(name, "filter") ? B_filter :
+           !strcasecmp(name, "reduce") ? B_reduce : !strcasecmp(name, "await") ? B_await : 0;
+}
+
+/* the built-in called name with args, 0 for the other names and -1 after
+   reporting arguments that do not fit, none at all included */
+static int function_builtin(char *name, struct ast *args) {
+    int f = builtin_name(name);
+    struct ast *rest = args && args->nodetype == '[' ? args->r : NULL;
+    int fits;
+
+    if (!f) return 0;
+    if (f == B_await)
+        fits = args && args->nodetype != '[';
+    else if (f == B_reduce)
+        fits = rest && args->l && rest->nodetype == '[' && rest->l && rest->l->nodetype == 'N' &&
+               (!rest->r || rest->r->nodetype != '[');
+    else
+        fits = rest && args->l && rest->nodetype == 'N';
+    if (fits) return f;
+    if (f == B_await)
+        yyerror("syntax error, await() expects a task");
+    else
+        yyerror("syntax error, %s() expects a list, a function name%s", name,
+                f == B_reduce ? " and an initial value" : "");
+    return -1;
+}
+
+/* a call to one of the names of function_builtin() always calls the
+   built-in, so a function of that name could never be called */
+static int reserved(char *name) {
+    if (!builtin_name(name)) return 0;
+    yyerror("syntax error, %s is a built-in function and cannot be defined", name);
+    return 1;
+}
+
+/* The lookahead token may already have been read into the nodes of the
+   program arena, so the arena of a statement is freed with the next one */
+static void run_statement(struct ast *a) {
+    optimize_ast(a);
+    resolve_unit(a);
+    execute(a);
+    arena_free(ctx->previous);
+    ctx->previous = arena_take();
+}
+
+/* parse and run f in the context of the thread */
+void run_file(FILE *f, int stream) {
+    yyset_in(f, ctx->scanner);
+    if(stream) {
+        ctx->start_token = STREAM;
+        interactive_input(1, ctx->scanner);
+    } else if(f != stdin) {
+        map_input(f, ctx->scanner);
     }
-    return 0;
+    yyparse();
+    unmap_input(ctx->scanner);
+}
+
+/* parse the input of the scanner of the context without running it: the
+   tree of its top level statements, NULL when there are none. The tree
+   is optimized and resolved, ready for execute() */
+struct ast *parse_program() {
+    ctx->start_token = COMPILE;
+    ctx->parsed = NULL;
+    yyparse();
+    optimize_ast(ctx->parsed);
+    resolve_unit(ctx->parsed);
+    return ctx->parsed;
 }
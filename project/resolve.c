@@ -0,0 +1,164 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include "helper.h"
+
+/* Bind every variable of a tree to the slot it will have at run time.
+   A scope is opened by each call of a user function and by each 'W', 'T'
+   and 'P' loop: every name declared in it gets its own slot, in order.
+   Names that the resolver cannot place (globals used inside a function,
+   which depend on the caller) keep depth -1 and are looked up by name.
+   All names also get a global slot, even when no global variable uses it,
+   so that the run time can tell when a name is not shadowed, and the names
+   a function may look up by name are marked for tail calls. */
+
+struct rscope {
+    struct rscope *up;  /* enclosing scope */
+    char **names;       /* name of each slot */
+    int count;
+    int size;
+    int global;         /* scope 0, its slots come from global_slot() */
+};
+
+static int in_function(struct rscope *sc) {
+    while (sc->up) sc = sc->up;
+    return !sc->global;
+}
+
+static int find_name(struct rscope *sc, char *name) {
+    for (int i = 0; i < sc->count; i++) {
+        if (sc->names[i] == name) return i;
+    }
+    return -1;
+}
+
+static int add_name(struct rscope *sc, char *name) {
+    if (sc->global) return global_slot(name);
+
+    int slot = find_name(sc, name);
+    if (slot >= 0) return slot;
+    global_slot(name);
+    if (sc->count == sc->size) {
+        sc->size = sc->size ? sc->size * 2 : 8;
+        sc->names = realloc(sc->names, sc->size * sizeof(char *));
+        if (!sc->names) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+    }
+    sc->names[sc->count] = name;
+    return sc->count++;
+}
+
+/* give a slot to the declarations that run in this scope, the ones inside
+   loops belong to the scope of the loop */
+static void collect(struct rscope *sc, struct ast *a) {
+    if (!a) return;
+
+    switch (a->nodetype) {
+        case 'D':
+            add_name(sc, a->data.sym->name);
+            /* read by name when used before the declaration runs */
+            if (in_function(sc)) mark_by_name(a->data.sym->name);
+            break;
+        case 'K': case 'S': case 'N': case 'W': case 'T': case 'P': break;
+        case 'I':
+            collect(sc, a->data.flow.cond);
+            collect(sc, a->data.flow.tl);
+            collect(sc, a->data.flow.el);
+            break;
+        default:
+            collect(sc, a->l);
+            collect(sc, a->r);
+    }
+}
+
+/* nearest scope that declares the name */
+static void bind(struct rscope *sc, struct ast *a) {
+    char *name = a->data.sym->name;
+
+    for (int depth = 0; sc; sc = sc->up, depth++) {
+        int slot = sc->global ? global_slot(name) : find_name(sc, name);
+        if (slot >= 0) {
+            a->depth = depth;
+            a->slot = slot;
+            return;
+        }
+    }
+    mark_by_name(name);
+    a->depth = -1;
+}
+
+static void resolve(struct rscope *sc, struct ast *a);
+
+/* 'W', 'T' and 'P' run their whole body in one scope of their own */
+static void resolve_loop(struct rscope *sc, struct ast *a) {
+    struct rscope inner = { .up = sc };
+
+    if (a->nodetype == 'W') {
+        collect(&inner, a->data.flow.cond);
+        collect(&inner, a->data.flow.tl);
+        resolve(&inner, a->data.flow.cond);
+        resolve(&inner, a->data.flow.tl);
+    } else {
+        collect(&inner, a->l);
+        collect(&inner, a->data.flow.cond);
+        collect(&inner, a->r);
+        resolve(&inner, a->l);
+        resolve(&inner, a->data.flow.cond);
+        resolve(&inner, a->r);
+    }
+    a->slot = inner.count;
+    free(inner.names);
+}
+
+static void resolve(struct rscope *sc, struct ast *a) {
+    if (!a) return;
+
+    switch (a->nodetype) {
+        case 'K': case 'S': break;
+        case 'N': bind(sc, a); break;
+        case '=': case 'C':
+            bind(sc, a);
+            resolve(sc, a->l);
+            break;
+        case 'D':
+            a->depth = 0;
+            a->slot = add_name(sc, a->data.sym->name);
+            break;
+        case 'I':
+            resolve(sc, a->data.flow.cond);
+            resolve(sc, a->data.flow.tl);
+            resolve(sc, a->data.flow.el);
+            break;
+        case 'P': /* the reductions are variables of the scope around the loop */
+            resolve(sc, a->data.flow.tl);
+            resolve_loop(sc, a);
+            break;
+        case 'W': case 'T': resolve_loop(sc, a); break;
+        default:
+            resolve(sc, a->l);
+            resolve(sc, a->r);
+    }
+}
+
+/* resolve a top level statement list */
+void resolve_unit(struct ast *a) {
+    struct rscope global = { .global = 1 };
+
+    resolve(&global, a);
+}
+
+/* resolve the body of a function, returns the number of slots of its scope */
+int resolve_function(struct symlist *syms, struct ast *body) {
+    struct rscope fn = { 0 };
+    struct symlist *sl;
+
+    for (sl = syms; sl; sl = sl->next) {
+        sl->slot = add_name(&fn, sl->sym->name);
+    }
+    collect(&fn, body);
+    resolve(&fn, body);
+    free(fn.names);
+    return fn.count;
+}
@@ -0,0 +1,623 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <strings.h>
+# include <ctype.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# ifdef __SSE2__
+# include <emmintrin.h>
+# endif
+# include "helper.h"
+# include "parser.tab.h"
+
+/* Hand-written scanner for the tokens of lexer.l, built instead of the
+   flex one with make SCANNER=simd. It gives the parser the same tokens,
+   values and line numbers, but where flex runs its automaton a character
+   at a time (and an action per character of a comment or a string) the
+   long runs are skipped 16 bytes at a time with SSE2: blanks, identifiers,
+   the characters of a string up to the next one that can end or escape
+   it, and comments up to their --/. Without SSE2 the same loops run a
+   byte at a time. */
+
+enum { INITIAL, STRING, COMMENT };  /* start conditions of lexer.l */
+
+#define CHUNK 65536
+
+/* State of one scanner, the yyscan_t of helper.h: each context has its
+   own, see context.c */
+struct scanner {
+    FILE *in;           /* yyin of flex */
+    int lineno;
+    int state;
+    YYSTYPE *lval;      /* value of the token being scanned */
+
+    /* The input scanned is [tok, end), followed by a '\0' that the value
+       of a number is read up to. It is either a mapped file or data, the
+       part of in read so far from the token being scanned on */
+    char *tok, *cur, *end;
+    char *data;
+    size_t data_size;
+    FILE *input;        /* the in being scanned */
+    int at_eof;
+    int interactive;    /* read a line at a time, as flex does for a terminal */
+
+    /* input file mapped in memory, see map_input() */
+    char *map_base;
+    size_t map_size;
+
+    /* A string literal is handed to the parser as a slice of the input
+       while it holds no escape, see lexer.l */
+    char *string_start;
+    int string_copied;
+    char *string_buffer;
+    size_t string_buffer_len;
+    size_t string_buffer_size;
+};
+
+static const struct keyword {
+    const char *name;
+    size_t length;
+    int token;
+    int value;      /* of DATA_TYPE and FUNC */
+} keywords[] = {
+#define KEYWORD(name, token, value) { name, sizeof(name) - 1, token, value }
+    KEYWORD("define", DEFINE, 0),
+    KEYWORD("give_back", RETURN, 0),
+    KEYWORD("whether", WHETHER, 0),
+    KEYWORD("then", THEN, 0),
+    KEYWORD("otherwise", OTHERWISE, 0),
+    KEYWORD("when", WHEN, 0),
+    KEYWORD("until", UNTIL, 0),
+    KEYWORD("from", FROM, 0),
+    KEYWORD("to", TO, 0),
+    KEYWORD("num", DATA_TYPE, 1),
+    KEYWORD("str", DATA_TYPE, 2),
+    KEYWORD("list", DATA_TYPE, 3),
+    KEYWORD("roman", DATA_TYPE, 6),
+    KEYWORD("binary", DATA_TYPE, 7),
+    KEYWORD("and", AND, 0),
+    KEYWORD("or", OR, 0),
+    KEYWORD("not", NOT, 0),
+    KEYWORD("sqrt", FUNC, B_sqrt),
+    KEYWORD("exp", FUNC, B_exp),
+    KEYWORD("log", FUNC, B_log),
+    KEYWORD("print", FUNC, B_print),
+    KEYWORD("fact", FUNC, B_fact),
+    KEYWORD("sin", FUNC, B_sin),
+    KEYWORD("cos", FUNC, B_cos),
+    KEYWORD("tan", FUNC, B_tan),
+    KEYWORD("size", FUNC, B_size),
+    KEYWORD("get", FUNC, B_get),
+    KEYWORD("input", FUNC, B_input),
+    KEYWORD("split", FUNC, B_split),
+    KEYWORD("count_char", FUNC, B_count_char),
+    KEYWORD("casual", FUNC, B_casual),
+#undef KEYWORD
+};
+
+/* start scanning yyin from its current position */
+static void switch_input(struct scanner *s) {
+    s->input = s->in;
+    s->tok = s->cur = s->end = s->data;
+    s->at_eof = 0;
+    s->interactive = isatty(fileno(s->in)) > 0;
+}
+
+/* Reads more of yyin after end, moving the token being scanned to the
+   start of data. Returns 0 at the end of the input */
+static int fill(struct scanner *s) {
+    size_t keep = s->end - s->tok, n = 0;
+    int c = EOF;
+
+    if (s->at_eof) return 0;
+    if (keep + CHUNK + 1 > s->data_size) {
+        char *moved;
+
+        s->data_size = 2 * s->data_size + CHUNK + 1;
+        moved = malloc(s->data_size);
+        if (!moved) {
+            fprintf(stderr, "Error in memory: impossible to expand the buffer.\n");
+            exit(1);
+        }
+        if (keep) memcpy(moved, s->tok, keep);
+        free(s->data);
+        s->data = moved;
+    } else if (keep) {
+        memmove(s->data, s->tok, keep);
+    }
+    s->cur = s->data + (s->cur - s->tok);
+    s->tok = s->data;
+    if (s->interactive) {
+        while (n < CHUNK && (c = getc(s->in)) != EOF && c != '\n') s->data[keep + n++] = c;
+        if (c == '\n') s->data[keep + n++] = c;
+    } else {
+        n = fread(s->data + keep, 1, CHUNK, s->in);
+    }
+    s->end = s->data + keep + n;
+    *s->end = '\0';
+    if (n == 0) s->at_eof = 1;
+    return n != 0;
+}
+
+/* character i of the token, EOF past the input */
+static int peek(struct scanner *s, size_t i) {
+    while (s->tok + i >= s->end) {
+        if (!fill(s)) return EOF;
+    }
+    return (unsigned char)s->tok[i];
+}
+
+/* first character from p on that is not a blank, the newlines are counted */
+static char *skip_blanks(struct scanner *s, char *p) {
+# ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), nl = _mm_set1_epi8('\n');
+
+    while (s->end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i lines = _mm_cmpeq_epi8(v, nl);
+        unsigned blank = _mm_movemask_epi8(_mm_or_si128(lines,
+                             _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab))));
+        unsigned newlines = _mm_movemask_epi8(lines);
+
+        if (blank != 0xffff) {
+            int i = __builtin_ctz(~blank);
+            s->lineno += __builtin_popcount(newlines & ((1u << i) - 1));
+            return p + i;
+        }
+        if (newlines) s->lineno += __builtin_popcount(newlines);
+        p += 16;
+    }
+# endif
+    for (; p < s->end && (*p == ' ' || *p == '\t' || *p == '\n'); p++) {
+        if (*p == '\n') s->lineno++;
+    }
+    return p;
+}
+
+/* first character from p on that cannot be in an identifier */
+static char *identifier_end(struct scanner *s, char *p) {
+# ifdef __SSE2__
+    const __m128i a = _mm_set1_epi8('a' - 1), z = _mm_set1_epi8('z' + 1);
+    const __m128i zero = _mm_set1_epi8('0' - 1), nine = _mm_set1_epi8('9' + 1);
+    const __m128i underscore = _mm_set1_epi8('_'), lower = _mm_set1_epi8(0x20);
+
+    while (s->end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i l = _mm_or_si128(v, lower);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(l, a), _mm_cmplt_epi8(l, z));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, zero), _mm_cmplt_epi8(v, nine));
+        unsigned in = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit),
+                                                     _mm_cmpeq_epi8(v, underscore)));
+
+        if (in != 0xffff) return p + __builtin_ctz(~in);
+        p += 16;
+    }
+# endif
+    while (p < s->end && (isalnum((unsigned char)*p) || *p == '_')) p++;
+    return p;
+}
+
+/* first character from p on that can end a string or start an escape,
+   or a newline */
+static char *string_special(struct scanner *s, char *p) {
+# ifdef __SSE2__
+    const __m128i gt = _mm_set1_epi8('>'), hash = _mm_set1_epi8('#'), backslash = _mm_set1_epi8('\\');
+    const __m128i quote = _mm_set1_epi8('"'), nl = _mm_set1_epi8('\n');
+
+    while (s->end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, hash)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, backslash), _mm_cmpeq_epi8(v, quote)));
+        unsigned special = _mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(v, nl)));
+
+        if (special) return p + __builtin_ctz(special);
+        p += 16;
+    }
+# endif
+    while (p < s->end && !strchr(">#\\\"\n", *p)) p++;
+    return p;
+}
+
+/* The --/ ending a comment from p on, or where to look for it once more
+   input is read. The newlines before it are counted */
+static char *comment_end(struct scanner *s, char *p) {
+# ifdef __SSE2__
+    const __m128i dash = _mm_set1_epi8('-'), slash = _mm_set1_epi8('/'), nl = _mm_set1_epi8('\n');
+
+    while (s->end - p >= 18) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i ends = _mm_and_si128(_mm_cmpeq_epi8(v, dash),
+                           _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 1)), dash),
+                                         _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 2)), slash)));
+        unsigned found = _mm_movemask_epi8(ends);
+        unsigned newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+
+        if (found) {
+            int i = __builtin_ctz(found);
+            s->lineno += __builtin_popcount(newlines & ((1u << i) - 1));
+            return p + i;
+        }
+        if (newlines) s->lineno += __builtin_popcount(newlines);
+        p += 16;
+    }
+# endif
+    for (; s->end - p >= 3; p++) {
+        if (p[0] == '-' && p[1] == '-' && p[2] == '/') return p;
+        if (*p == '\n') s->lineno++;
+    }
+    return p;
+}
+
+static void add_text(struct scanner *s, const char *text, size_t n) {
+    if (!s->string_copied || !n) return; /* still a slice of the input */
+    if (s->string_buffer_len + n > s->string_buffer_size) {
+        s->string_buffer_size = 2 * s->string_buffer_size + n;
+        s->string_buffer = realloc(s->string_buffer, s->string_buffer_size);
+        if (!s->string_buffer) {
+            fprintf(stderr, "Error in memory: impossible to expand the buffer.\n");
+            exit(1);
+        }
+    }
+    memcpy(s->string_buffer + s->string_buffer_len, text, n);
+    s->string_buffer_len += n;
+}
+
+/* characters of the input from the start of the string to at, without
+   the newlines */
+static void copy_slice(struct scanner *s, char *at) {
+    char *p = s->string_start, *nl;
+
+    s->string_copied = 1;
+    while ((nl = memchr(p, '\n', at - p))) {
+        add_text(s, p, nl - p);
+        p = nl + 1;
+    }
+    add_text(s, p, at - p);
+}
+
+static void add_escape(struct scanner *s, char *at, const char *text, size_t n) {
+    if (!s->string_copied) copy_slice(s, at);
+    add_text(s, text, n);
+}
+
+/* at is the >> closing the literal */
+static void end_string(struct scanner *s, char *at) {
+    if (s->string_copied) {
+        s->lval->st.s = s->string_buffer_len ? s->string_buffer : "";
+        s->lval->st.length = s->string_buffer_len;
+    } else {
+        s->lval->st.s = s->string_start;
+        s->lval->st.length = at - s->string_start;
+    }
+}
+
+/* Characters of a string literal up to its >>. Returns STR, or 0 when
+   the input ends first */
+static int string(struct scanner *s) {
+    for (;;) {
+        char *p = string_special(s, s->cur);
+        int c;
+
+        add_text(s, s->cur, p - s->cur);
+        s->cur = s->tok = p;
+        if (s->cur == s->end) {
+            if (!fill(s)) return 0;
+            continue;
+        }
+        if (*s->cur == '\n') {
+            putchar('\n');  /* no rule of lexer.l takes it: flex echoes it */
+            if (!s->string_copied) copy_slice(s, s->cur);
+            s->cur++;
+            continue;
+        }
+        c = tolower(peek(s, 1));
+        if (*s->cur == '>' && c == '>') {
+            end_string(s, s->cur);
+            s->cur += 2;
+            s->state = INITIAL;
+            return STR;
+        } else if (*s->cur == '#' && (c == 'k' || c == 'j')) {
+            add_escape(s, s->cur, c == 'k' ? "\n" : "\t", 1);
+            s->cur += 2;
+        } else if (*s->cur == '\\' && c == '#' && (tolower(peek(s, 2)) == 'k' || tolower(peek(s, 2)) == 'j')) {
+            add_escape(s, s->cur, tolower(peek(s, 2)) == 'k' ? "#k" : "#j", 2);
+            s->cur += 3;
+        } else if (*s->cur == '"' && c == '"') {
+            add_escape(s, s->cur, "\"", 1);
+            s->cur += 2;
+        } else {
+            add_text(s, s->cur, 1);
+            s->cur++;
+        }
+    }
+}
+
+static int is_digit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+/* ends of one digit group of {ROM}, such as (XC|XL|L?X*), from i */
+static int roman_group(struct scanner *s, size_t i, int one, int five, int ten, size_t *ends) {
+    int n = 0;
+    size_t j = i;
+
+    if (toupper(peek(s, i)) == one && (toupper(peek(s, i + 1)) == ten || toupper(peek(s, i + 1)) == five))
+        ends[n++] = i + 2;
+    if (toupper(peek(s, j)) == five) j++;
+    while (toupper(peek(s, j)) == one) j++;
+    ends[n++] = j;
+    return n;
+}
+
+/* length of the longest {ROM} at tok, which is a 0 */
+static size_t roman_length(struct scanner *s) {
+    size_t i = 1, best = 1, c[2], x[2], u[2];
+    int nc, nx, nu;
+
+    while (toupper(peek(s, i)) == 'M') i++;
+    nc = roman_group(s, i, 'C', 'D', 'M', c);
+    for (int a = 0; a < nc; a++) {
+        nx = roman_group(s, c[a], 'X', 'L', 'C', x);
+        for (int b = 0; b < nx; b++) {
+            nu = roman_group(s, x[b], 'I', 'V', 'X', u);
+            for (int d = 0; d < nu; d++) {
+                if (u[d] > best) best = u[d];
+            }
+        }
+    }
+    return best;
+}
+
+/* {DEC}, {BIN} or {ROM} at tok, whichever is longest; on a tie the
+   first one in lexer.l */
+static int number(struct scanner *s) {
+    size_t dec = 0, bin = 0, rom = 0;
+    int token;
+    char saved;
+
+    while (is_digit(peek(s, dec))) dec++;
+    if (peek(s, dec) == '.' && is_digit(peek(s, dec + 1))) {
+        dec++;
+        while (is_digit(peek(s, dec))) dec++;
+    }
+    if (*s->tok == '0') {
+        if (tolower(peek(s, 1)) == 'b' && (peek(s, 2) == '0' || peek(s, 2) == '1')) {
+            bin = 3;
+            while (peek(s, bin) == '0' || peek(s, bin) == '1') bin++;
+        }
+        rom = roman_length(s);
+    }
+    if (rom > dec && rom > bin) {
+        s->cur = s->tok + rom;
+        token = ROMAN;
+    } else if (bin > dec) {
+        s->cur = s->tok + bin;
+        token = BINARY;
+    } else {
+        s->cur = s->tok + dec;
+        token = NUM;
+    }
+    saved = *s->cur;
+    *s->cur = '\0';
+    if (token == ROMAN) s->lval->num = roman_to_int(s->tok);
+    else if (token == BINARY) s->lval->num = strtol(s->tok + 2, NULL, 2);
+    else s->lval->num = atof(s->tok);
+    *s->cur = saved;
+    return token;
+}
+
+static int identifier(struct scanner *s) {
+    size_t length;
+
+    for (;;) {
+        s->cur = identifier_end(s, s->cur);
+        if (s->cur < s->end || !fill(s)) break;
+    }
+    length = s->cur - s->tok;
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        const struct keyword *k = &keywords[i];
+
+        if (k->length == length && !strncasecmp(k->name, s->tok, length)) {
+            if (k->token == DATA_TYPE) s->lval->dt = k->value;
+            else if (k->token == FUNC) s->lval->fn = k->value;
+            return k->token;
+        }
+    }
+    s->lval->s = newsym(s->tok, length);
+    return ID;
+}
+
+/* comparison of one or two characters */
+static int compare(struct scanner *s, int fn, size_t length) {
+    s->cur = s->tok + length;
+    s->lval->fn = fn;
+    return CMP;
+}
+
+yyscan_t new_scanner() {
+    struct scanner *s = calloc(1, sizeof(struct scanner));
+
+    if (!s) {
+        fprintf(stderr, "Error in memory: impossible to create the scanner.\n");
+        exit(1);
+    }
+    s->lineno = 1;
+    return s;
+}
+
+void free_scanner(yyscan_t scanner) {
+    struct scanner *s = scanner;
+
+    unmap_input(s);
+    free(s->data);
+    free(s->string_buffer);
+    free(s);
+}
+
+void yyset_in(FILE *f, yyscan_t scanner) {
+    ((struct scanner *)scanner)->in = f;
+}
+
+int yyget_lineno(yyscan_t scanner) {
+    return ((struct scanner *)scanner)->lineno;
+}
+
+void yyset_lineno(int lineno, yyscan_t scanner) {
+    ((struct scanner *)scanner)->lineno = lineno;
+}
+
+int yylex(YYSTYPE *lval, yyscan_t scanner) {
+    struct scanner *s = scanner;
+
+    s->lval = lval;
+    if (!s->in) s->in = stdin;
+    if (s->in != s->input) switch_input(s);
+    for (;;) {
+        char c;
+
+        s->tok = s->cur;
+        if (s->state == COMMENT) {
+            s->cur = s->tok = comment_end(s, s->cur);
+            if (s->end - s->cur >= 3) {
+                s->cur += 3;
+                s->state = INITIAL;
+            } else if (!fill(s)) {
+                for (; s->cur < s->end; s->cur++) if (*s->cur == '\n') s->lineno++;
+                return 0;
+            }
+            continue;
+        }
+        if (s->state == STRING) return string(s);
+        if (s->cur == s->end && !fill(s)) return 0;
+
+        c = *s->cur;
+        if (c == ' ' || c == '\t' || c == '\n') {
+            s->cur = skip_blanks(s, s->cur);
+            continue;
+        }
+        if (isalpha((unsigned char)c) || c == '_') return identifier(s);
+        if (is_digit(c)) return number(s);
+        s->cur++;
+        switch (c) {
+        case '+': return PLUS;
+        case '*': return MUL;
+        case '^': return POW;
+        case '%': return MOD;
+        case '|': return ABS;
+        case '-':
+            if (peek(s, 1) == '-' && peek(s, 2) == '-') { /* "---".*\n */
+                char *nl;
+
+                while (!(nl = memchr(s->tok + 3, '\n', s->end - s->tok - 3)) && fill(s))
+                    ;
+                if (nl) {
+                    s->cur = nl + 1;
+                    s->lineno++;
+                    continue;
+                }
+                s->cur = s->tok + 1;
+            }
+            return MINUS;
+        case '/':
+            if (peek(s, 1) == '-' && peek(s, 2) == '-') {
+                s->cur = s->tok + 3;
+                s->state = COMMENT;
+                continue;
+            }
+            return DIV;
+        case '=':
+            if (peek(s, 1) == '=') return compare(s, 4, 2);
+            return ASSIGN;
+        case '!':
+            if (peek(s, 1) == '>') {
+                s->cur = s->tok + 2;
+                return STEP;
+            }
+            return c;
+        case '>':
+            if (peek(s, 1) == '=') return compare(s, 5, 2);
+            return compare(s, 1, 1);
+        case '<':
+            if (peek(s, 1) == '<') {
+                s->cur = s->tok + 2;
+                s->state = STRING;
+                s->string_start = s->cur;
+                s->string_buffer_len = 0;
+                s->string_copied = !s->map_base;
+                continue;
+            }
+            if (peek(s, 1) == '>') return compare(s, 3, 2);
+            if (peek(s, 1) == '=') return compare(s, 6, 2);
+            return compare(s, 2, 1);
+        default:
+            return c;
+        }
+    }
+}
+
+/* Scans f from a private mapping of the file instead of reading it.
+   Returns 0 when f cannot be mapped, it is then read as usual */
+int map_input(FILE *f, yyscan_t scanner) {
+    struct scanner *s = scanner;
+    struct stat st;
+    char *base;
+
+    if (fstat(fileno(f), &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return 0;
+    s->map_size = st.st_size + 1;
+    base = mmap(NULL, s->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 0;
+    if (mmap(base, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(f), 0) == MAP_FAILED) {
+        munmap(base, s->map_size);
+        return 0;
+    }
+    s->map_base = base;
+    s->input = f;
+    s->tok = s->cur = s->map_base;
+    s->end = s->map_base + st.st_size;
+    s->at_eof = 1;
+    return 1;
+}
+
+/* Scans a copy of text, mapped as a file would be */
+int map_string(const char *text, size_t length, yyscan_t scanner) {
+    struct scanner *s = scanner;
+    char *base;
+
+    s->map_size = length + 1;
+    base = mmap(NULL, s->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 0;
+    memcpy(base, text, length);
+    if (!s->in) s->in = stdin;
+    s->map_base = base;
+    s->input = s->in;
+    s->tok = s->cur = s->map_base;
+    s->end = s->map_base + length;
+    s->at_eof = 1;
+    return 1;
+}
+
+void unmap_input(yyscan_t scanner) {
+    struct scanner *s = scanner;
+
+    if (!s->map_base) return;
+    if (s->state == STRING && !s->string_copied) copy_slice(s, s->end); /* it goes on in the next file */
+    munmap(s->map_base, s->map_size);
+    s->map_base = NULL;
+    s->input = NULL;
+}
+
+int input_read_whole(yyscan_t scanner) {
+    struct scanner *s = scanner;
+
+    return s->map_base || feof(s->in);
+}
+
+void interactive_input(int on, yyscan_t scanner) {
+    struct scanner *s = scanner;
+
+    if (!s->in) s->in = stdin;
+    if (s->in != s->input) switch_input(s);
+    s->interactive = on;
+}
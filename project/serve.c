@@ -0,0 +1,462 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <errno.h>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# include <sys/wait.h>
+# include "helper.h"
+# include "synthax.h"
+
+/* Daemons running scripts for synthax-client on a Unix socket.
+
+   synthax --serve path keeps the scripts it has run compiled, with the
+   functions they define, and runs them again for the next requests. A
+   script is compiled again only when its file changes. It runs one
+   request at a time.
+
+   synthax --zygote path lib.txt ... runs the library scripts once, then
+   forks a process for each connection, which runs the script of the
+   request with the functions and variables of the libraries, answers
+   and exits. A job costs about a fork, runs alongside the others, and
+   whatever it does, the zygote stays as the libraries left it.
+
+   A request and its answer are lines, the values of strings being sent
+   as their length and then their bytes:
+
+       run <path of the script>        ->  output <length>
+       num <name> <number>                 <what the script printed>
+       str <name> <length>                 num <name> <number>
+       <bytes>                             str <name> <length>
+       get <name>                          <bytes>
+       end                                 none <name>
+                                           status <0, or 1 after an error>
+
+   num and str bind the input variables of the run, get asks for the
+   value of a global variable after it, answered by num, str or none in
+   the order of the gets. The output has what the script printed to
+   stdout and stderr. */
+
+/* a script compiled by an earlier request of --serve */
+struct resident {
+    char *path;
+    struct timespec mtime;
+    off_t size;
+    struct synthax_program *program;    /* NULL when the script has errors */
+    struct resident *next;
+};
+
+static struct resident *residents;
+static enum synthax_engine serve_engine;
+static volatile sig_atomic_t stopping;
+
+static void stop_serving(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+/* an input variable of a request */
+struct binding {
+    char *name;
+    val_t value;    /* a number or a malloc'd string */
+    struct binding *next;
+};
+
+/* a request: the script it runs, its inputs and the variables it asks for */
+struct request {
+    char *script;
+    struct binding *inputs, **last;
+    char **gets;
+    int ngets;
+};
+
+static void free_request(struct request *rq) {
+    while (rq->inputs) {
+        struct binding *next = rq->inputs->next;
+        if (rq->inputs->value.type == 2) free(rq->inputs->value.data.string);
+        free(rq->inputs->name);
+        free(rq->inputs);
+        rq->inputs = next;
+    }
+    for (int i = 0; i < rq->ngets; i++) free(rq->gets[i]);
+    free(rq->gets);
+    free(rq->script);
+}
+
+/* a line of the request without its newline, NULL at the end of input */
+static char *get_line(FILE *in, char **line, size_t *size) {
+    ssize_t n = getline(line, size, in);
+
+    if (n <= 0) return NULL;
+    if ((*line)[n - 1] == '\n') (*line)[n - 1] = '\0';
+    return *line;
+}
+
+/* the bytes of a str of length n, and the newline after them */
+static char *get_string(FILE *in, long n) {
+    char *s;
+
+    if (n < 0 || !(s = malloc(n + 1))) return NULL;
+    if (fread(s, 1, n, in) != (size_t)n || getc(in) != '\n') {
+        free(s);
+        return NULL;
+    }
+    s[n] = '\0';
+    return s;
+}
+
+static int add_input(struct request *rq, const char *name, val_t value) {
+    struct binding *b = calloc(1, sizeof(struct binding));
+
+    if (!b || !(b->name = strdup(name))) {
+        free(b);
+        return 0;
+    }
+    b->value = value;
+    *rq->last = b;
+    rq->last = &b->next;
+    return 1;
+}
+
+/* Reads a request, 0 at the end of the connection or when it is not one */
+static int read_request(FILE *in, struct request *rq) {
+    char *line = NULL, *name, *value;
+    size_t size = 0;
+    int ok = 0;
+
+    rq->last = &rq->inputs;
+    if (!get_line(in, &line, &size) || strncmp(line, "run ", 4)) goto done;
+    if (!(rq->script = strdup(line + 4))) goto done;
+
+    while (get_line(in, &line, &size) && strcmp(line, "end")) {
+        if (!(name = strchr(line, ' '))) goto done;
+        name++;
+        if (!strncmp(line, "num ", 4) && (value = strchr(name, ' '))) {
+            *value++ = '\0';
+            if (!add_input(rq, name, (val_t){.type = 1, .data.number = strtod(value, NULL)})) goto done;
+        } else if (!strncmp(line, "str ", 4) && (value = strchr(name, ' '))) {
+            char *s;
+
+            *value++ = '\0';
+            if (!(s = get_string(in, strtol(value, NULL, 10)))) goto done;
+            if (!add_input(rq, name, (val_t){.type = 2, .data.string = s})) {
+                free(s);
+                goto done;
+            }
+        } else if (!strncmp(line, "get ", 4)) {
+            char **g = realloc(rq->gets, (rq->ngets + 1) * sizeof(char *));
+
+            if (!g) goto done;
+            rq->gets = g;
+            if (!(g[rq->ngets] = strdup(name))) goto done;
+            rq->ngets++;
+        } else {
+            goto done;
+        }
+    }
+    ok = line && !strcmp(line, "end");
+done:
+    free(line);
+    return ok;
+}
+
+/* stdout and stderr go to the file out until restore_output() */
+static void capture_output(int out) {
+    fflush(stdout);
+    fflush(stderr);
+    if (ftruncate(out, 0) < 0 || lseek(out, 0, SEEK_SET) < 0) perror("synthax");
+    dup2(out, 1);
+    dup2(out, 2);
+}
+
+static void restore_output(int stdout_fd, int stderr_fd) {
+    fflush(stdout);
+    fflush(stderr);
+    dup2(stdout_fd, 1);
+    dup2(stderr_fd, 2);
+}
+
+/* the global variable name left by the run of the program p with
+   --serve, NULL when the script did not compile, or of the context in
+   use for a --zygote job: 1 for a number, 2 for a string, 0 when there
+   is neither */
+static int result_of(struct synthax_program *p, int job, const char *name, double *number, const char **string) {
+    struct symbol *s;
+
+    if (!job) {
+        if (!p) return 0;
+        if (synthax_get_number(p, name, number)) return 1;
+        return (*string = synthax_get_string(p, name)) ? 2 : 0;
+    }
+    if (!(s = slot_at(0, global_slot(intern(name, strlen(name)))))) return 0;
+    if (s->type == 1 || s->type == 6 || s->type == 7) {
+        *number = s->value;
+        return 1;
+    }
+    if (s->type != 2) return 0;
+    *string = s->string;
+    return 2;
+}
+
+/* the answer to a request, the output of the run being in the file out */
+static void answer(FILE *sock, int out, struct request *rq, struct synthax_program *p, int job, int status) {
+    char buffer[BUFSIZ];
+    off_t length = lseek(out, 0, SEEK_END);
+    ssize_t n;
+
+    fprintf(sock, "output %lld\n", (long long)length);
+    lseek(out, 0, SEEK_SET);
+    while (length > 0 && (n = read(out, buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, n, sock);
+        length -= n;
+    }
+    for (int i = 0; i < rq->ngets; i++) {
+        const char *s;
+        double number;
+
+        switch (result_of(p, job, rq->gets[i], &number, &s)) {
+            case 1: fprintf(sock, "num %s %.17g\n", rq->gets[i], number); break;
+            case 2: fprintf(sock, "str %s %zu\n%s\n", rq->gets[i], strlen(s), s); break;
+            default: fprintf(sock, "none %s\n", rq->gets[i]); break;
+        }
+    }
+    fprintf(sock, "status %d\n", status);
+    fflush(sock);
+}
+
+/* the program of the script at path, compiled again when its file has
+   changed since */
+static struct resident *resident_of(const char *path) {
+    struct resident *r;
+    struct stat st;
+
+    if (stat(path, &st) < 0) {
+        perror(path);
+        return NULL;
+    }
+    for (r = residents; r; r = r->next) {
+        if (!strcmp(r->path, path)) break;
+    }
+    if (r && r->size == st.st_size && r->mtime.tv_sec == st.st_mtim.tv_sec
+            && r->mtime.tv_nsec == st.st_mtim.tv_nsec)
+        return r;
+    if (!r) {
+        if (!(r = calloc(1, sizeof(struct resident))) || !(r->path = strdup(path))) {
+            fprintf(stderr, "Error in memory: impossible to compile the script.\n");
+            free(r);
+            return NULL;
+        }
+        r->next = residents;
+        residents = r;
+    }
+    synthax_free(r->program);
+    r->program = synthax_compile_file(path, serve_engine);
+    r->mtime = st.st_mtim;
+    r->size = st.st_size;
+    return r;
+}
+
+/* --serve: runs the request on the program of its script, which is left
+   in p. The status of the run */
+static int run_resident(struct request *rq, struct synthax_program **p) {
+    struct resident *r = resident_of(rq->script);
+
+    *p = r ? r->program : NULL;
+    if (!*p) return 1;
+    synthax_clear_inputs(*p);
+    for (struct binding *b = rq->inputs; b; b = b->next) {
+        if (b->value.type == 2) synthax_set_string(*p, b->name, b->value.data.string);
+        else synthax_set_number(*p, b->name, b->value.data.number);
+    }
+    return synthax_run(*p);
+}
+
+/* --zygote: runs the request in the context the libraries left. The
+   status of the run */
+static int run_job(struct request *rq) {
+    FILE *f = fopen(rq->script, "r");
+    struct ast *tree;
+    jmp_buf stop;
+
+    if (!f) {
+        perror(rq->script);
+        return 1;
+    }
+    for (struct binding *b = rq->inputs; b; b = b->next) {
+        struct symbol *s = declare(intern(b->name, strlen(b->name)));
+
+        if (s->type == 2) string_release(s->string);
+        s->type = b->value.type;
+        if (s->type == 2) s->string = new_string(b->value.data.string, strlen(b->value.data.string));
+        else s->value = b->value.data.number;
+    }
+    ctx->stop = &stop;
+    if (setjmp(stop)) {
+        unmap_input(ctx->scanner);
+        fclose(f);
+        return 1; /* an error stopped the script */
+    }
+    /* parsed whole, then run, as synthax_compile() and synthax_run() do
+       for --serve: no tree is printed, a syntax error runs nothing */
+    yyset_in(f, ctx->scanner);
+    map_input(f, ctx->scanner);
+    tree = parse_program();
+    if (tree) execute(tree);
+    ctx->stop = NULL;
+    arena_free_program();
+    unmap_input(ctx->scanner);
+    fclose(f);
+    return 0;
+}
+
+/* a socket listening at path, -1 when there is none */
+static int listen_on(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct sigaction sa = { .sa_handler = stop_serving };
+    int listener;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path); /* left by a daemon before */
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0
+            || listen(listener, 64) < 0) {
+        perror(path);
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);  /* a client gone is only a write error */
+    sigaction(SIGINT, &sa, NULL);   /* no SA_RESTART: accept() returns */
+    sigaction(SIGTERM, &sa, NULL);
+    return listener;
+}
+
+/* the requests of one connection, one after the other */
+static void serve_connection(int fd, int out, int stdout_fd, int stderr_fd) {
+    FILE *in = fdopen(fd, "r"), *sock = fdopen(dup(fd), "w");
+
+    while (in && sock && !stopping) {
+        struct request rq = { 0 };
+        struct synthax_program *p;
+        int status;
+
+        if (!read_request(in, &rq)) {
+            free_request(&rq);
+            break;
+        }
+        capture_output(out);
+        status = run_resident(&rq, &p);
+        restore_output(stdout_fd, stderr_fd);
+        answer(sock, out, &rq, p, 0, status);
+        free_request(&rq);
+    }
+    if (in) fclose(in);
+    else close(fd);
+    if (sock) fclose(sock);
+}
+
+int serve(const char *path, enum engine engine) {
+    int listener = listen_on(path), stdout_fd, stderr_fd;
+    FILE *out;     /* what a run prints, see capture_output() */
+
+    if (listener < 0) return 1;
+    serve_engine = engine == ENGINE_VM ? SYNTHAX_VM : SYNTHAX_TREE;
+    if (!(out = tmpfile()) || (stdout_fd = dup(1)) < 0 || (stderr_fd = dup(2)) < 0) {
+        perror("synthax --serve");
+        return 1;
+    }
+
+    while (!stopping) {
+        int fd = accept(listener, NULL, NULL);
+
+        if (fd < 0) {
+            if (errno != EINTR) perror("accept");
+            continue;
+        }
+        serve_connection(fd, fileno(out), stdout_fd, stderr_fd);
+    }
+    close(listener);
+    unlink(path);
+    fclose(out);
+    while (residents) {
+        struct resident *next = residents->next;
+        synthax_free(residents->program);
+        free(residents->path);
+        free(residents);
+        residents = next;
+    }
+    return 0;
+}
+
+/* the process of a connection: one request, run on its copy of the
+   context of the zygote */
+static void job(int fd) {
+    FILE *in = fdopen(fd, "r"), *sock = fdopen(dup(fd), "w"), *out = tmpfile();
+    struct request rq = { 0 };
+    int stdout_fd = dup(1), stderr_fd = dup(2), status;
+
+    if (!in || !sock || !out || stdout_fd < 0 || stderr_fd < 0) _exit(1);
+    if (read_request(in, &rq)) {
+        capture_output(fileno(out));
+        status = run_job(&rq);
+        restore_output(stdout_fd, stderr_fd);
+        answer(sock, fileno(out), &rq, NULL, 1, status);
+    }
+    _exit(0); /* the copy of the zygote needs no tearing down */
+}
+
+/* the jobs that have ended: one killed by a signal is reported, its
+   client only sees the answer cut short */
+static void reap_jobs(void) {
+    pid_t pid;
+    int status;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (WIFSIGNALED(status))
+            fprintf(stderr, "synthax --zygote: job %d killed by signal %d\n", (int)pid, WTERMSIG(status));
+    }
+}
+
+static void job_ended(int sig) {
+    (void)sig; /* accept() returns, see reap_jobs() */
+}
+
+int zygote(const char *path) {
+    struct sigaction sa = { .sa_handler = job_ended };
+    int listener = listen_on(path);
+
+    if (listener < 0) return 1;
+    sigaction(SIGCHLD, &sa, NULL);
+    fflush(stdout);  /* or each job would print it again */
+    fflush(stderr);
+
+    while (!stopping) {
+        int fd = accept(listener, NULL, NULL);
+        pid_t pid;
+
+        if (fd < 0) {
+            if (errno != EINTR) perror("accept");
+            reap_jobs();
+            continue;
+        }
+        reap_jobs();
+        if ((pid = fork()) == 0) {
+            close(listener);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGCHLD, SIG_DFL);
+            job(fd);
+        }
+        if (pid < 0) perror("fork");
+        close(fd);
+    }
+    close(listener);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,150 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <strings.h>
+# include <stddef.h>
+# include "helper.h"
+
+/* Strings are immutable and shared: a value, a variable or a list element
+   holding a string holds a reference to it, and the string is freed when
+   the last one goes away. The characters follow a small header with the
+   reference count and the length, and the char * handed around points to
+   them, so a string can still be printed or compared as a C string.
+   Reading, passing and assigning a string only count references.
+
+   A string nothing else holds can still grow: s = s + e and the partial
+   sums of a + b + c add to the end of the string, whose room doubles when
+   it runs out, so building a string a piece at a time is amortized O(1)
+   per piece.
+
+   While the threads of a parallel loop share the values of a context
+   (values_shared(), see parallel.c) the references are counted with
+   atomic operations. */
+
+struct string {
+    int refs;
+    size_t length;
+    size_t capacity;    /* room for characters, without the final '\0' */
+    char chars[];
+};
+
+static struct string *header(char *s) {
+    return (struct string *)(s - offsetof(struct string, chars));
+}
+
+/* references to s, another thread can be counting them */
+static int refs(char *s) {
+    if (values_shared()) return __atomic_load_n(&header(s)->refs, __ATOMIC_RELAXED);
+    return header(s)->refs;
+}
+
+/* string of length characters with one reference, for the caller */
+static struct string *string_alloc(size_t length) {
+    struct string *str = malloc(sizeof(struct string) + length + 1);
+    if (!str) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    str->refs = 1;
+    str->length = length;
+    str->capacity = length;
+    str->chars[length] = '\0';
+    return str;
+}
+
+/* s with b added at its end, s is held by the caller only. Returns s,
+   which moves when it has to grow */
+static char *append(char *s, char *b) {
+    struct string *str = header(s);
+    size_t lb = string_length(b);
+
+    if (str->length + lb > str->capacity) {
+        size_t capacity = 2 * str->capacity;
+        if (capacity < str->length + lb) capacity = str->length + lb;
+        str = realloc(str, sizeof(struct string) + capacity + 1);
+        if (!str) {
+            yyerror("Out of memory");
+            exit(1);
+        }
+        str->capacity = capacity;
+    }
+    memcpy(str->chars + str->length, b, lb + 1);
+    str->length += lb;
+    return str->chars;
+}
+
+/* New string holding a copy of the length characters at s */
+char *new_string(const char *s, size_t length) {
+    struct string *str = string_alloc(length);
+
+    memcpy(str->chars, s, length);
+    return str->chars;
+}
+
+/* New string with the characters of a followed by the ones of b */
+char *concat_strings(char *a, char *b) {
+    size_t la = string_length(a), lb = string_length(b);
+    struct string *str = string_alloc(la + lb);
+
+    memcpy(str->chars, a, la);
+    memcpy(str->chars + la, b, lb);
+    return str->chars;
+}
+
+/* a + b for two references, which are given back. When the value of a
+   is the only holder of its string, b is added to it */
+char *add_strings(char *a, char *b) {
+    char *s;
+
+    if (refs(a) == 1) {
+        s = append(a, b);
+    } else {
+        s = concat_strings(a, b);
+        string_release(a);
+    }
+    string_release(b);
+    return s;
+}
+
+/* x = x + b where sym is x and s the value of x read for the sum: when the
+   variable and s are the only holders of the string, b is added to it in
+   place and the reference of s is given back. Returns 0 if it cannot be
+   done */
+int string_add_in_place(struct symbol *sym, char *s, char *b) {
+    if (sym->type != 2 || sym->string != s || refs(s) != 2) return 0;
+
+    string_release(s);
+    sym->string = append(s, b);
+    return 1;
+}
+
+size_t string_length(char *s) {
+    return header(s)->length;
+}
+
+/* == on strings ignores the case */
+int string_equal(char *a, char *b) {
+    return a == b || (string_length(a) == string_length(b) && strcasecmp(a, b) == 0);
+}
+
+/* reference to the string of a variable, an empty one when it was never set */
+char *symbol_string(struct symbol *sym) {
+    if (!sym->string) return new_string("", 0);
+    string_retain(sym->string);
+    return sym->string;
+}
+
+void string_retain(char *s) {
+    if (!s) return;
+    if (values_shared())
+        __atomic_add_fetch(&header(s)->refs, 1, __ATOMIC_RELAXED);
+    else
+        header(s)->refs++;
+}
+
+void string_release(char *s) {
+    if (!s) return;
+    if (values_shared() ? __atomic_sub_fetch(&header(s)->refs, 1, __ATOMIC_ACQ_REL) == 0
+                      : --header(s)->refs == 0)
+        free(header(s));
+}
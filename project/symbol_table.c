@@ -3,117 +3,349 @@
 # include <stdarg.h>
 # include <string.h>
 # include <math.h>
+# include <stddef.h>
 # include "helper.h"
 
 /* Initial size*/
-#define NHASH 100
-#define MAX_SCOPE_DEPTH 128
+#define NHASH 128
+/* The state of the symbol table is in the context, see struct synthax_ctx.
+   The scope stack starts in initial_scopes and moves to the heap when
+   deeper recursion needs more room */
 
-scope_t scope_stack[MAX_SCOPE_DEPTH];
-int scope_top = 0;  // Last active scope
+/* Every name is stored once, as an atom: the lexer gets the same pointer
+   for each occurrence of an identifier, so names are compared with ==, and
+   the atom remembers the global slot of the name, so that finding it does
+   not hash the name again */
+struct atom {
+    struct atom *next;  /* in the same bucket */
+    unsigned hash;
+    int global;         /* global slot + 1, 0 when the name has none yet */
+    char name[];
+};
+
+/* global_names are the names of the global slots, so that the resolver
+   and the run time agree on the slot of every global variable.
+
+   local_count is the number of variables of each global name alive in
+   function and loop scopes, a name nobody shadows is found without walking
+   the stack; untracked counts the local variables whose name has no
+   global slot.
+
+   by_name marks the names that a function body may look up by name,
+   through the scopes of its callers: set by the resolver, see
+   scopes_seen_by_name() */
 
 /* symbol table */
 /* hash a symbol */
-static unsigned symhash(char *sym)
+static unsigned symhash(const char *sym, size_t length)
 {
     unsigned int hash = 0;
     unsigned c;
-    while((c = *sym++)) { hash = hash*9 ^ c; }
+    while(length--) { c = (unsigned char)*sym++; hash = hash*9 ^ c; }
     return hash;
 }
 
-/* Expand the symbol table */
-void expand_symtab(int scopeidx) {
-    size_t new_size = (scope_stack[scopeidx].symtab_size == 0) ? NHASH : scope_stack[scopeidx].symtab_size * 2;    struct symbol *new_symtab = calloc(new_size, sizeof(struct symbol));
-    if (!new_symtab) {
+static struct atom *atom_of(char *name) {
+    return (struct atom *)(name - offsetof(struct atom, name));
+}
+
+static void expand_atoms() {
+    int size = ctx->atom_buckets ? ctx->atom_buckets * 2 : NHASH;
+    struct atom **bigger = calloc(size, sizeof(struct atom *));
+    if (!bigger) {
         perror("ERROR: Unable to expand symbol table");
         exit(EXIT_FAILURE);
     }
+    for (int i = 0; i < ctx->atom_buckets; i++) {
+        struct atom *at = ctx->atoms[i];
+        while (at) {
+            struct atom *next = at->next;
+            at->next = bigger[at->hash % size];
+            bigger[at->hash % size] = at;
+            at = next;
+        }
+    }
+    free(ctx->atoms);
+    ctx->atoms = bigger;
+    ctx->atom_buckets = size;
+}
+
+/* the atom of the length characters of name */
+char *intern(const char *name, size_t length) {
+    if (ctx->atom_count >= 0.7 * ctx->atom_buckets) expand_atoms();
 
-    // Reallocate the symbols
-    for (size_t i = 0; i < scope_stack[scopeidx].symtab_size; i++) {
-        if (scope_stack[scopeidx].symtab[i].name != NULL) {
-            unsigned int new_index = symhash(scope_stack[scopeidx].symtab[i].name) % new_size;
-            unsigned int probe = 1;
-            while (new_symtab[new_index].name != NULL) {
-                new_index = (new_index + probe * (probe)) % new_size; // Quadratic probing
-                probe++;
-            }
-            new_symtab[new_index] = scope_stack[scopeidx].symtab[i];
+    unsigned hash = symhash(name, length);
+    struct atom **bucket = &ctx->atoms[hash % ctx->atom_buckets];
+    for (struct atom *at = *bucket; at; at = at->next) {
+        if (at->hash == hash && !strncmp(at->name, name, length) && !at->name[length])
+            return at->name;
+    }
+    struct atom *at = malloc(sizeof(struct atom) + length + 1);
+    if (!at) {
+        perror("ERROR: Unable to expand symbol table");
+        exit(EXIT_FAILURE);
+    }
+    at->hash = hash;
+    at->global = 0;
+    memcpy(at->name, name, length);
+    at->name[length] = '\0';
+    at->next = *bucket;
+    *bucket = at;
+    ctx->atom_count++;
+    return at->name;
+}
+
+/* Slot arrays of popped scopes, kept for the next scopes, one free list
+   for each power of two size so that calls do not go to malloc: in
+   free_slots, SLOT_CLASSES of them */
+
+static int size_class(int n) {
+    int c = 0;
+    while ((8 << c) < n) c++;
+    return c;
+}
+
+static struct symbol *alloc_slots(int c) {
+    struct symbol *s = ctx->free_slots[c];
+    if (s) {
+        ctx->free_slots[c] = *(struct symbol **)s;
+        return s;
+    }
+    s = malloc((8 << c) * sizeof(struct symbol));
+    if (!s) {
+        perror("ERROR: Unable to expand symbol table");
+        exit(EXIT_FAILURE);
+    }
+    return s;
+}
+
+static void release_slots(struct symbol *s, int size) {
+    if (!s) return;
+    int c = size_class(size);
+    *(struct symbol **)s = ctx->free_slots[c];
+    ctx->free_slots[c] = s;
+}
+
+/* Make room for n slots in a scope */
+static void reserve_slots(scope_t *sc, int n) {
+    if (n <= sc->symtab_size) return;
+    int c = size_class(n);
+    struct symbol *s = alloc_slots(c);
+    if (sc->symtab) {
+        memcpy(s, sc->symtab, sc->symtab_size * sizeof(struct symbol));
+    }
+    memset(s + sc->symtab_size, 0, ((8 << c) - sc->symtab_size) * sizeof(struct symbol));
+    release_slots(sc->symtab, sc->symtab_size);
+    sc->symtab = s;
+    sc->symtab_size = 8 << c;
+}
+
+/* Make room for more global slots */
+static void expand_globals() {
+    int old_size = ctx->global_size;
+    int new_size = old_size ? old_size * 2 : NHASH;
+
+    ctx->global_size = new_size;
+    ctx->global_names = realloc(ctx->global_names, new_size * sizeof(char *));
+    ctx->local_count = realloc(ctx->local_count, new_size * sizeof(int));
+    ctx->by_name = realloc(ctx->by_name, new_size);
+    if (!ctx->global_names || !ctx->local_count || !ctx->by_name) {
+        perror("ERROR: Unable to expand symbol table");
+        exit(EXIT_FAILURE);
+    }
+    memset(ctx->local_count + old_size, 0, (new_size - old_size) * sizeof(int));
+    memset(ctx->by_name + old_size, 0, new_size - old_size);
+}
+
+/* slot of a global name, -1 if it was never seen and reserve is not set */
+static int find_global(char *sym, int reserve) {
+    scope_t *sc = &ctx->scope_stack[0];
+    struct atom *at = atom_of(sym);
+
+    if (at->global) return at->global - 1;
+    if (!reserve) return -1;
+
+    if (sc->symtab_count == ctx->global_size) expand_globals();
+    int slot = sc->symtab_count++;
+    reserve_slots(sc, sc->symtab_count);
+    ctx->global_names[slot] = sym;
+    at->global = slot + 1;
+    return slot;
+}
+
+int global_slot(char *sym) {
+    return find_global(sym, 1);
+}
+
+void mark_by_name(char *sym) {
+    int slot = find_global(sym, 1);
+    ctx->by_name[slot] = 1;
+}
+
+/* can a function look up by name one of the variables of scopes from..top?
+   If not, they can be dropped before a tail call */
+int scopes_seen_by_name(int from) {
+    for (int i = from; i <= ctx->scope_top; i++) {
+        scope_t *sc = &ctx->scope_stack[i];
+        for (int j = 0; j < sc->symtab_count; j++) {
+            if (!sc->symtab[j].name) continue;
+            int slot = find_global(sc->symtab[j].name, 0);
+            if (slot < 0 || ctx->by_name[slot]) return 1;
         }
     }
+    return 0;
+}
+
+static void count_local(char *sym, int delta) {
+    int slot = find_global(sym, 0);
+    if (slot >= 0) {
+        ctx->local_count[slot] += delta;
+    } else {
+        ctx->untracked += delta;
+    }
+}
 
-    // Free the old symbol table and update the global variables
-    free(scope_stack[scopeidx].symtab);
-    scope_stack[scopeidx].symtab = new_symtab;
-    scope_stack[scopeidx].symtab_size = new_size;
+/* Turn an empty slot into a fresh variable, named by an atom */
+static struct symbol *new_entry(struct symbol *sp, char *sym) {
+    sp->name = sym;
+    sp->value = 0;
+    sp->type = 0;
+    sp->string = NULL;
+    sp->func = NULL;
+    sp->syms = NULL;
+    sp->list = NULL;
+    sp->arena = NULL;
+    sp->code = NULL;
+    sp->nslots = 0;
+    return sp;
 }
 
 /* lookup symbol */
-struct symbol *_lookup(char* sym, int scopeidx, int newentry)
+static struct symbol *_lookup(char* sym, int scopeidx, int newentry)
 {
-    if (scope_stack[scopeidx].symtab_size == 0){
-        expand_symtab(scopeidx); //initialize the symbol table
-    }
-    else if (scope_stack[scopeidx].symtab_count >= 0.7 * scope_stack[scopeidx].symtab_size) {
-        expand_symtab(scopeidx); // Expand the symbol table if it's more than 70% full
+    scope_t *sc = &ctx->scope_stack[scopeidx];
+
+    if (scopeidx == 0) {
+        int slot = find_global(sym, newentry);
+        if (slot < 0) return NULL;
+        struct symbol *sp = &sc->symtab[slot];
+        if (sp->name) return sp; /* symbol found */
+        return newentry ? new_entry(sp, ctx->global_names[slot]) : NULL;
     }
-    unsigned int index = symhash(sym) % scope_stack[scopeidx].symtab_size;    
-    struct symbol *sp = &scope_stack[scopeidx].symtab[index];
-    int scount = scope_stack[scopeidx].symtab_size; /* how many have we looked at */
-    while(--scount >= 0) {
-        if(sp->name && !strcmp(sp->name, sym)) { 
+    for (int i = 0; i < sc->symtab_count; i++) {
+        struct symbol *sp = &sc->symtab[i];
+        if (sp->name == sym) {
             return sp;  /* symbol found*/
         }
-        if(!sp->name) { /* new entry */
-            if (newentry){
-            sp->name = strdup(sym);
-            sp->value = 0;
-            sp->type = 0;
-            sp->string = NULL;
-            sp->func = NULL;
-            sp->syms = NULL;
-            sp->list = NULL;
-
-            scope_stack[scopeidx].symtab_count++;
-            return sp; /* new entry */
-            } else {
-                return NULL; 
-            }
-        }
-        if(++sp >= scope_stack[scopeidx].symtab+scope_stack[scopeidx].symtab_size) sp = scope_stack[scopeidx].symtab; /* try the next entry */   
     }
-    yyerror("symbol table overflow\n");
-    abort(); /* tried them all, table is full */
+    if (!newentry) return NULL;
+
+    /* not known to the resolver: accesses through this scope go by name from now on */
+    reserve_slots(sc, sc->symtab_count + 1);
+    sc->extras = 1;
+    count_local(sym, 1);
+    return new_entry(&sc->symtab[sc->symtab_count++], sym);
 }
 
 struct symbol *lookup (char *sym) {
 	struct symbol *s = NULL;
-	for (int i = scope_top; i >= 0; i--) {
+	int slot = find_global(sym, 0);
+	if (slot >= 0 && !ctx->local_count[slot] && !ctx->untracked) {
+		s = &ctx->scope_stack[0].symtab[slot];
+		if (s->name)
+			return s;
+		return _lookup(sym, ctx->scope_top, 1);
+	}
+	for (int i = ctx->scope_top; i >= 0; i--) {
 		s = _lookup(sym, i, 0);
 		if (s)
 			break;
 	}
 	if (!s)
-		s = _lookup(sym, scope_top, 1);
+		s = _lookup(sym, ctx->scope_top, 1);
 
 	return s;
 }
 
+/* variable of a name as lookup() finds it, NULL when there is none:
+   nothing is created */
+struct symbol *find_symbol(char *sym) {
+	for (int i = ctx->scope_top; i >= 0; i--) {
+		struct symbol *s = _lookup(sym, i, 0);
+		if (s)
+			return s;
+	}
+	return NULL;
+}
+
 struct symbol *declare (char *sym) {
-	struct symbol *s = _lookup(sym, scope_top, 1);
+	struct symbol *s = _lookup(sym, ctx->scope_top, 1);
 
 	return s;
 }
 
+/* variable the resolver bound to a slot, depth scopes below the top,
+   NULL when it has to be looked up by name */
+struct symbol *slot_at(int depth, int slot) {
+    if (depth < 0) return NULL;
+
+    int target = ctx->scope_top - depth;
+    for (int i = ctx->scope_top; i > target; i--) {
+        if (ctx->scope_stack[i].extras) return NULL;
+    }
+    if (target > 0 && ctx->scope_stack[target].extras) return NULL;
+
+    struct symbol *s = &ctx->scope_stack[target].symtab[slot];
+    if (!s->name) return NULL; /* not declared yet */
+    return s;
+}
+
+struct symbol *lookup_at(int depth, int slot, char *sym) {
+    struct symbol *s = slot_at(depth, slot);
+    return s ? s : lookup(sym);
+}
+
+/* declaration of a variable the resolver bound to a slot of the current scope */
+struct symbol *declare_at(int slot, char *sym) {
+    scope_t *sc = &ctx->scope_stack[ctx->scope_top];
+
+    if (slot < 0 || (ctx->scope_top > 0 && sc->extras)) return declare(sym);
+
+    struct symbol *s = &sc->symtab[slot];
+    if (!s->name) {
+        if (ctx->scope_top > 0) count_local(sym, 1);
+        new_entry(s, ctx->scope_top > 0 ? sym : ctx->global_names[slot]);
+    }
+    return s;
+}
+
+/* declaration: the variable takes the type, or the function, of the symbol
+   of the declaration, which belongs to the tree. A function or a string it
+   held before cannot be reached any more and is released, the body of the
+   function once the tree is */
+struct symbol *declare_symbol(int slot, struct symbol *decl) {
+    struct symbol *s = declare_at(slot, decl->name);
+    char *name = s->name;
+
+    if (s->arena && s->arena != decl->arena) {
+        arena_retire(s->arena, s->syms);
+        free_bytecode(s->code);
+    }
+    if (s->type == 2) string_release(s->string);
+    if (s->type == 3 && !s->func) list_release(s->list);
+    *s = *decl;
+    s->name = name;
+    return s;
+}
+
 // Print the symble table
 void print_symtab() {
 printf("Symbol Table Contents:\n");
-	for (int x = scope_top; x >= 0; x--) {
+	for (int x = ctx->scope_top; x >= 0; x--) {
 		printf("\nLevel %d:\n", x);
-		for (size_t i = 0; i < scope_stack[x].symtab_size; i++) {
-			if (scope_stack[x].symtab[i].name != NULL) {
-				printf("Name: %s, Value: %.2f, Type: %d\n", scope_stack[x].symtab[i].name, scope_stack[x].symtab[i].value, scope_stack[x].symtab[i].type);
+		for (size_t i = 0; i < ctx->scope_stack[x].symtab_count; i++) {
+			if (ctx->scope_stack[x].symtab[i].name != NULL) {
+				printf("Name: %s, Value: %.2f, Type: %d\n", ctx->scope_stack[x].symtab[i].name, ctx->scope_stack[x].symtab[i].value, ctx->scope_stack[x].symtab[i].type);
         }
     }
 }
@@ -130,6 +362,7 @@ struct symlist *newsymlist(struct symbol *sym, struct symlist *next)
  }
  sl->sym = sym;
  sl->next = next;
+ sl->slot = -1;
  return sl;
 }
 
@@ -146,37 +379,160 @@ void symlistfree(struct symlist *sl)
 
 /* Scope */
 
-void push_scope() {
-    if (scope_top >= MAX_SCOPE_DEPTH - 1) {
-        yyerror("Scope stack overflow");
-        exit(1);
+void push_scope(int nslots) {
+    if (ctx->scope_top == ctx->scope_stack_size - 1) {
+        scope_t *bigger = malloc(2 * ctx->scope_stack_size * sizeof(scope_t));
+        if (!bigger) {
+            yyerror("Scope stack overflow");
+            exit(1);
+        }
+        memcpy(bigger, ctx->scope_stack, ctx->scope_stack_size * sizeof(scope_t));
+        if (ctx->scope_stack != ctx->initial_scopes) free(ctx->scope_stack);
+        ctx->scope_stack = bigger;
+        ctx->scope_stack_size *= 2;
+    }
+    ctx->scope_top++;
+    scope_t *sc = &ctx->scope_stack[ctx->scope_top];
+    sc->symtab = NULL;
+    sc->symtab_size = 0;
+    sc->symtab_count = nslots;
+    sc->extras = 0;
+    if (nslots > 0) { /* only the declared slots need to start empty */
+        int c = size_class(nslots);
+        sc->symtab = alloc_slots(c);
+        sc->symtab_size = 8 << c;
+        memset(sc->symtab, 0, nslots * sizeof(struct symbol));
     }
-    scope_top++;
-    scope_stack[scope_top].symtab = NULL;
-    scope_stack[scope_top].symtab_size = 0;
-    scope_stack[scope_top].symtab_count = 0;
 
-    //printf("Scope created, level: %d\n", scope_top);
+    //printf("Scope created, level: %d\n", ctx->scope_top);
 }
 
 void pop_scope() {
-    if (scope_top < 0) {
+    if (ctx->scope_top <= 0) {
         yyerror("Error: pop on empty scope stack");
         return;
     }
-    free(scope_stack[scope_top--].symtab);
+    scope_t *sc = &ctx->scope_stack[ctx->scope_top--];
+    for (int i = 0; i < sc->symtab_count; i++) {
+        if (sc->symtab[i].name) count_local(sc->symtab[i].name, -1);
+        if (sc->symtab[i].type == 2) string_release(sc->symtab[i].string);
+        if (sc->symtab[i].type == 3 && !sc->symtab[i].func) list_release(sc->symtab[i].list);
+    }
+    release_slots(sc->symtab, sc->symtab_size);
+}
+
+/* empty the global variables and functions, the names keep their slots:
+   a program run again starts from no variables, see synthax_run() */
+void clear_globals() {
+    scope_t *sc = &ctx->scope_stack[0];
+
+    for (int i = 0; i < sc->symtab_count; i++) {
+        struct symbol *s = &sc->symtab[i];
+        if (s->arena) {
+            arena_free(s->arena);
+            free_bytecode(s->code);
+            symlistfree(s->syms);
+        }
+        if (s->type == 2) string_release(s->string);
+        if (s->type == 3 && !s->func) list_release(s->list);
+        memset(s, 0, sizeof(struct symbol));
+    }
+}
+
+static void free_slot_lists() {
+    for (int c = 0; c < SLOT_CLASSES; c++) {
+        while (ctx->free_slots[c]) {
+            struct symbol *next = *(struct symbol **)ctx->free_slots[c];
+            free(ctx->free_slots[c]);
+            ctx->free_slots[c] = next;
+        }
+    }
+}
+
+/* The scopes of a context sharing the variables of from, see
+   synthax_ctx_share(): its stack starts as a copy of the one of from, with
+   the same slot arrays, and only the scopes pushed on it are its own. The
+   names are the ones of from, which no one changes meanwhile, the counts
+   of local variables are its own */
+void share_scopes(struct synthax_ctx *from) {
+    ctx->scope_stack_size = from->scope_stack_size;
+    ctx->scope_stack = malloc(ctx->scope_stack_size * sizeof(scope_t));
+    ctx->local_count = malloc(from->global_size * sizeof(int));
+    if (!ctx->scope_stack || (!ctx->local_count && from->global_size)) {
+        perror("ERROR: Unable to expand symbol table");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(ctx->scope_stack, from->scope_stack, (from->scope_top + 1) * sizeof(scope_t));
+    memcpy(ctx->local_count, from->local_count, from->global_size * sizeof(int));
+    ctx->scope_top = from->scope_top;
+    ctx->atoms = from->atoms;
+    ctx->atom_count = from->atom_count;
+    ctx->atom_buckets = from->atom_buckets;
+    ctx->global_names = from->global_names;
+    ctx->global_size = from->global_size;
+    ctx->untracked = from->untracked;
+    ctx->by_name = from->by_name;
+}
+
+/* what share_scopes() gave the context, the scopes pushed since have been
+   popped */
+void unshare_scopes() {
+    if (ctx->scope_stack != ctx->initial_scopes) free(ctx->scope_stack);
+    ctx->scope_stack = ctx->initial_scopes;
+    ctx->scope_stack_size = INITIAL_SCOPE_DEPTH;
+    ctx->scope_top = 0;
+    free_slot_lists();
+    free(ctx->local_count);
+    ctx->local_count = NULL;
+}
+
+/* everything the symbol table of the context holds: the scopes, their
+   variables and the atoms */
+void free_scopes() {
+    while (ctx->scope_top > 0) pop_scope();
+
+    scope_t *sc = &ctx->scope_stack[0];
+    clear_globals();
+    release_slots(sc->symtab, sc->symtab_size);
+    sc->symtab = NULL;
+    sc->symtab_size = sc->symtab_count = 0;
+    if (ctx->scope_stack != ctx->initial_scopes) free(ctx->scope_stack);
+    ctx->scope_stack = ctx->initial_scopes;
+    ctx->scope_stack_size = INITIAL_SCOPE_DEPTH;
+
+    free_slot_lists();
+    for (int i = 0; i < ctx->atom_buckets; i++) {
+        struct atom *at = ctx->atoms[i];
+        while (at) {
+            struct atom *next = at->next;
+            free(at);
+            at = next;
+        }
+    }
+    free(ctx->atoms);
+    free(ctx->global_names);
+    free(ctx->local_count);
+    free(ctx->by_name);
+    ctx->atoms = NULL;
+    ctx->global_names = NULL;
+    ctx->local_count = NULL;
+    ctx->by_name = NULL;
+    ctx->atom_count = ctx->atom_buckets = ctx->global_size = ctx->untracked = 0;
 }
 
 void print_all_scopes() {
     printf("\n=== Print all scopes ===\n");
-    for (int i = scope_top; i >= 0; i--) {
+    for (int i = ctx->scope_top; i >= 0; i--) {
+        int declared = 0;
         printf("Scope level %d:\n", i);
-    for (int j = 0; j < scope_stack[i].symtab_count; j++) {
-            struct symbol *sym = &scope_stack[i].symtab[j];
+    for (int j = 0; j < ctx->scope_stack[i].symtab_count; j++) {
+            struct symbol *sym = &ctx->scope_stack[i].symtab[j];
+            if (!sym->name) continue;
+            declared++;
             printf("  - Nome: %s, Valore: %.2f, Tipo: %d\n", 
                    sym->name, sym->value, sym->type);
         }
-        if (scope_stack[i].symtab_count == 0) {
+        if (declared == 0) {
             printf("  (empty)\n");
         }
         printf("-----------------------------\n");
@@ -0,0 +1,257 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include "helper.h"
+# include "synthax.h"
+
+/* The library API of synthax.h. A program is a context of its own holding
+   the parsed script: the tree, resolved once, and for the vm its bytecode
+   and the one of its functions, compiled once. A run clears the global
+   variables, binds the inputs and runs the tree or the bytecode again */
+
+/* an input variable, bound again before each run */
+struct input {
+    char *name;     /* an atom */
+    val_t value;    /* a number or a string */
+    struct input *next;
+};
+
+/* a function the program defines: the runs only declare it, its body
+   belongs to the program, see adopt_functions() */
+struct function {
+    struct arena *arena;
+    struct bytecode *code;
+    struct symlist *syms;
+};
+
+struct synthax_program {
+    struct synthax_ctx *ctx;
+    struct ast *tree;           /* top level statements */
+    struct bytecode *code;      /* of the tree, for the vm */
+    struct function *functions;
+    int nfunctions;
+    struct input *inputs;
+};
+
+/* The symbol of a definition owns the body of the function, and the
+   declaration of the function again would free it: the program takes the
+   body, so that it stays for the next runs, and compiles it for the vm */
+static void adopt_functions(struct synthax_program *p, struct ast *a) {
+    struct function *f;
+    struct symbol *fn;
+
+    if (!a) return;
+    if (a->nodetype == 'L') {
+        adopt_functions(p, a->l);
+        adopt_functions(p, a->r);
+        return;
+    }
+    if (a->nodetype != 'D' || !a->data.sym->func) return;
+
+    f = realloc(p->functions, (p->nfunctions + 1) * sizeof(struct function));
+    if (!f) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    p->functions = f;
+    f += p->nfunctions++;
+    fn = a->data.sym;
+    f->arena = fn->arena;
+    f->syms = fn->syms;
+    f->code = fn->code = ctx->engine == ENGINE_VM ? compile_function(fn) : NULL;
+    fn->arena = NULL;
+}
+
+struct synthax_program *synthax_compile(const char *text, size_t length, enum synthax_engine engine) {
+    struct synthax_program *p = calloc(1, sizeof(struct synthax_program));
+    struct synthax_ctx *outer = ctx;
+    jmp_buf stop;
+
+    if (!p) {
+        fprintf(stderr, "Error in memory: impossible to compile the script.\n");
+        return NULL;
+    }
+    p->ctx = synthax_ctx_new();
+    synthax_ctx_use(p->ctx);
+    ctx->engine = engine == SYNTHAX_VM ? ENGINE_VM : ENGINE_TREE;
+    ctx->stop = &stop;
+    if (setjmp(stop)) { /* an error in the script */
+        struct arena *ar;
+
+        while ((ar = arena_end())) arena_free(ar); /* function being parsed */
+        synthax_ctx_use(outer);
+        synthax_free(p);
+        return NULL;
+    }
+    /* the input stays mapped, so that the errors of the runs stop them */
+    if (!map_string(text, length, ctx->scanner)) {
+        fprintf(stderr, "Error in memory: impossible to compile the script.\n");
+        longjmp(stop, 1);
+    }
+    p->tree = parse_program();
+    adopt_functions(p, p->tree);
+    if (ctx->engine == ENGINE_VM && p->tree) p->code = compile_unit(p->tree);
+    ctx->stop = NULL;
+    synthax_ctx_use(outer);
+    return p;
+}
+
+struct synthax_program *synthax_compile_file(const char *path, enum synthax_engine engine) {
+    FILE *f = fopen(path, "r");
+    struct synthax_program *p = NULL;
+    char *text = NULL;
+    long length = -1;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    if (!fseek(f, 0, SEEK_END)) length = ftell(f);
+    if (length < 0 || fseek(f, 0, SEEK_SET) || !(text = malloc(length + 1))
+            || fread(text, 1, length, f) != (size_t)length) {
+        perror(path);
+    } else {
+        p = synthax_compile(text, length, engine);
+    }
+    free(text);
+    fclose(f);
+    return p;
+}
+
+void synthax_free(struct synthax_program *p) {
+    struct synthax_ctx *outer = ctx;
+
+    if (!p) return;
+    synthax_ctx_use(p->ctx);
+    synthax_clear_inputs(p);
+    free_bytecode(p->code);
+    for (int i = 0; i < p->nfunctions; i++) {
+        arena_free(p->functions[i].arena);
+        free_bytecode(p->functions[i].code);
+        symlistfree(p->functions[i].syms);
+    }
+    free(p->functions);
+    synthax_ctx_free(p->ctx);
+    synthax_ctx_use(outer);
+    free(p);
+}
+
+/* the input called name, unset when it is new */
+static struct input *input_of(struct synthax_program *p, const char *name) {
+    char *atom = intern(name, strlen(name));
+    struct input *in;
+
+    for (in = p->inputs; in; in = in->next) {
+        if (in->name == atom) {
+            drop_value(in->value);
+            return in;
+        }
+    }
+    in = calloc(1, sizeof(struct input));
+    if (!in) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    in->name = atom;
+    in->next = p->inputs;
+    p->inputs = in;
+    return in;
+}
+
+void synthax_set_number(struct synthax_program *p, const char *name, double value) {
+    struct synthax_ctx *outer = ctx;
+
+    synthax_ctx_use(p->ctx);
+    input_of(p, name)->value = (val_t){.type = 1, .data.number = value};
+    synthax_ctx_use(outer);
+}
+
+void synthax_set_string(struct synthax_program *p, const char *name, const char *value) {
+    struct synthax_ctx *outer = ctx;
+
+    synthax_ctx_use(p->ctx);
+    input_of(p, name)->value = (val_t){.type = 2, .data.string = new_string(value, strlen(value))};
+    synthax_ctx_use(outer);
+}
+
+void synthax_clear_inputs(struct synthax_program *p) {
+    struct synthax_ctx *outer = ctx;
+
+    synthax_ctx_use(p->ctx);
+    while (p->inputs) {
+        struct input *next = p->inputs->next;
+        drop_value(p->inputs->value);
+        free(p->inputs);
+        p->inputs = next;
+    }
+    synthax_ctx_use(outer);
+}
+
+static void bind_inputs(struct synthax_program *p) {
+    clear_globals();
+    for (struct input *in = p->inputs; in; in = in->next) {
+        struct symbol *s = declare(in->name);
+
+        s->type = in->value.type;
+        if (s->type == 2) {
+            string_retain(in->value.data.string);
+            s->string = in->value.data.string;
+        } else {
+            s->value = in->value.data.number;
+        }
+    }
+}
+
+int synthax_run(struct synthax_program *p) {
+    struct synthax_ctx *outer = ctx;
+    jmp_buf stop;
+    int status = 0;
+
+    synthax_ctx_use(p->ctx);
+    ctx->stop = &stop;
+    if (setjmp(stop)) { /* an error stopped the run in a function */
+        while (ctx->scope_top > 0) pop_scope();
+        ctx->frame_scope = 0;
+        ctx->running = NULL;
+        status = 1;
+    } else {
+        bind_inputs(p);
+        ctx->return_flag = 0;
+        ctx->halted = 0;
+        if (p->code) vm_exec(p->code);
+        else if (p->tree) drop_value(eval(p->tree));
+    }
+    ctx->stop = NULL;
+    synthax_ctx_use(outer);
+    return status;
+}
+
+/* global variable called name, NULL when the script left none */
+static struct symbol *global_of(const char *name) {
+    return slot_at(0, global_slot(intern(name, strlen(name))));
+}
+
+int synthax_get_number(struct synthax_program *p, const char *name, double *value) {
+    struct synthax_ctx *outer = ctx;
+    struct symbol *s;
+    int found;
+
+    synthax_ctx_use(p->ctx);
+    s = global_of(name);
+    found = s && (s->type == 1 || s->type == 6 || s->type == 7);
+    if (found) *value = s->value;
+    synthax_ctx_use(outer);
+    return found;
+}
+
+const char *synthax_get_string(struct synthax_program *p, const char *name) {
+    struct synthax_ctx *outer = ctx;
+    struct symbol *s;
+    const char *value = NULL;
+
+    synthax_ctx_use(p->ctx);
+    s = global_of(name);
+    if (s && s->type == 2) value = s->string;
+    synthax_ctx_use(outer);
+    return value;
+}
@@ -0,0 +1,51 @@
+#ifndef SYNTHAX_H
+#define SYNTHAX_H
+
+#include <stddef.h>
+
+/* Embedding synthax (libsynthax.a, libsynthax.so): a script is compiled
+   once to a program, then run as many times as needed, each time with
+   the input variables bound to it, and the variables it leaves are read
+   back.
+
+       struct synthax_program *p = synthax_compile(text, length, SYNTHAX_VM);
+       double total;
+
+       synthax_set_number(p, "price", 12.5);
+       if (synthax_run(p) == 0 && synthax_get_number(p, "total", &total))
+           ...
+       synthax_free(p);
+
+   A program has its own variables and functions: different programs can
+   run at the same time on different threads, but a program is used by
+   one thread at a time. Errors are reported on stderr as by synthax. */
+
+enum synthax_engine {
+    SYNTHAX_TREE,   /* walks the syntax tree, as synthax --engine=tree */
+    SYNTHAX_VM      /* runs bytecode, as synthax --engine=vm */
+};
+
+struct synthax_program;
+
+/* NULL when the script has errors */
+struct synthax_program *synthax_compile(const char *text, size_t length, enum synthax_engine engine);
+struct synthax_program *synthax_compile_file(const char *path, enum synthax_engine engine);
+void synthax_free(struct synthax_program *p);
+
+/* Input variables, global variables of the script at the start of every
+   run until they are set again or cleared */
+void synthax_set_number(struct synthax_program *p, const char *name, double value);
+void synthax_set_string(struct synthax_program *p, const char *name, const char *value);
+void synthax_clear_inputs(struct synthax_program *p);
+
+/* Runs the script from no variables but the inputs. Returns 0, or 1 when
+   an error stopped it */
+int synthax_run(struct synthax_program *p);
+
+/* Global variables left by the last run: 0 when there is no such number,
+   NULL when there is no such string. The string is valid until the next
+   run */
+int synthax_get_number(struct synthax_program *p, const char *name, double *value);
+const char *synthax_get_string(struct synthax_program *p, const char *name);
+
+#endif
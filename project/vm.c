@@ -0,0 +1,618 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <math.h>
+# include "helper.h"
+
+/* Stack machine running the bytecode produced by bytecode.c.
+   User function calls push a heap allocated frame instead of recursing on
+   the C stack, and a give_back simply unwinds the current frame. */
+
+struct frame {
+    struct bytecode *bc;
+    struct instr *ip;   /* where to resume after a call */
+    size_t base;        /* stack depth on entry, the stack can move */
+    int scope_base;     /* scope_top to restore on return */
+    val_t last;         /* value of the last statement executed */
+};
+
+/* The stacks of values and frames are in the context, they grow as needed.
+   halted is set when a give_back at top level stops the program, as in
+   eval() */
+
+static const val_t zero = {.type = 1, .data.number = 0.0};
+
+static val_t *grow_stack(val_t *sp) {
+    size_t used = sp - ctx->stack;
+    size_t size = ctx->stack ? (ctx->stack_end - ctx->stack) * 2 : 256;
+    ctx->stack = realloc(ctx->stack, size * sizeof(val_t));
+    if (!ctx->stack) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    ctx->stack_end = ctx->stack + size;
+    return ctx->stack + used;
+}
+
+static struct frame *grow_frames(struct frame *fp) {
+    size_t used = fp - ctx->frames;
+    size_t size = ctx->frames ? (ctx->frames_end - ctx->frames) * 2 : 64;
+    ctx->frames = realloc(ctx->frames, size * sizeof(struct frame));
+    if (!ctx->frames) {
+        yyerror("Out of memory");
+        exit(1);
+    }
+    ctx->frames_end = ctx->frames + size;
+    return ctx->frames + used;
+}
+
+#define PUSH(x) do { if (sp == ctx->stack_end) sp = grow_stack(sp); *sp++ = (x); } while (0)
+#define POP() (*--sp)
+
+/* call, which runs functions of its own, above the frames and the values
+   in use: the stacks can move meanwhile, see vm_call() */
+#define CALL_OUT(call) do { \
+        size_t stack_used = ctx->stack_used, frames_used = ctx->frames_used; \
+        ctx->stack_used = sp - ctx->stack; \
+        ctx->frames_used = fp - ctx->frames + 1; \
+        call; \
+        sp = ctx->stack + ctx->stack_used; \
+        fp = ctx->frames + ctx->frames_used - 1; \
+        ctx->stack_used = stack_used; \
+        ctx->frames_used = frames_used; \
+    } while (0)
+
+static val_t num(double d) {
+    return (val_t){.type = 1, .data.number = d};
+}
+
+static struct symbol *var(struct instr *i) {
+    return lookup_at(i->depth, i->slot, i->k.sym->name);
+}
+
+static val_t load(struct instr *i) {
+    struct symbol *sym = var(i);
+    if (sym->type == 2) {
+        return (val_t){.type = 2, .data.string = symbol_string(sym)};
+    } else if (sym->type == 3) {
+        list_retain(sym->list);
+        return (val_t){.type = 3, .data.list = sym->list};
+    }
+    return num(sym->value);
+}
+
+/* assignment, lst holds the elements when the right side is a list literal.
+   The variable takes val, and lst when it needs it */
+static val_t store(struct instr *i, val_t val, struct list *lst) {
+    struct symbol *sym = var(i);
+
+    /* Treat numeric data-types equally*/
+    if ((sym->type == 6 || sym->type == 7) && val.type == 1) {
+        val.type = sym->type;
+    }
+    if (sym->type != val.type && sym->type != 3) {
+        yyerror("Type mismatch: cannot assign type %d to variable '%s' of type %d",
+                val.type, sym->name, sym->type);
+        drop_value(val);
+        list_release(lst);
+        if (sym->type == 1 || sym->type == 6 || sym->type == 7) {
+            return num(sym->value);
+        } else if (sym->type == 2) {
+            return (val_t){.type = 2, .data.string = symbol_string(sym)};
+        }
+        return zero;
+    }
+    if (sym->type == 1 || sym->type == 6 || sym->type == 7) {
+        sym->value = val.data.number;
+        return num(sym->value);
+    }
+    if (sym->type == 2) {
+        string_release(sym->string);
+        sym->string = val.data.string;
+        return (val_t){.type = 2, .data.string = symbol_string(sym)};
+    }
+    list_release(sym->list);
+    if (val.type == 3 && val.data.list) { //list already declared
+        sym->list = val.data.list;
+        list_release(lst);
+        return zero;
+    }
+    sym->list = lst ? lst : list_of_value(val);
+    list_retain(sym->list);
+    drop_value(val);
+    return (val_t){.type = 3, .data.list = sym->list};
+}
+
+/* declaration without initializer */
+static val_t store_init(struct instr *i) {
+    struct symbol *sym = var(i);
+
+    if (sym->type == 1 || sym->type == 6 || sym->type == 7) {
+        sym->value = 0.0;
+        return zero;
+    } else if (sym->type == 2) {
+        sym->value = 0.0;
+        string_release(sym->string);
+        sym->string = new_string("", 0);
+        return (val_t){.type = 2, .data.string = symbol_string(sym)};
+    } else if (sym->type == 3) {
+        list_release(sym->list);
+        sym->list = NULL;
+        return (val_t){.type = 3, .data.list = NULL};
+    }
+    yyerror("Unkown type of variable '%s'", sym->name);
+    return zero;
+}
+
+/* value of a list literal, see the '[' case of eval() */
+static void chain(val_t *x, int n) {
+    for (int i = n - 2; i >= 0; i--) {
+        struct list *lst = x[i].data.list;
+
+        if (x[i].type != 3) continue;
+        if (x[i + 1].type == 3) {
+            x[i].data.list = concat_lists(lst, x[i + 1].data.list);
+        } else {
+            x[i].data.list = list_of_value(x[i]);
+        }
+        list_release(lst);
+    }
+}
+
+static void drop_values(val_t *x, int n) {
+    for (int i = 0; i < n; i++) drop_value(x[i]);
+}
+
+static struct list *chain_list(val_t *x, int n) {
+    struct list *head = new_list(n);
+    for (int i = 0; i < n; i++) {
+        list_push(head, element_of_value(x[i]));
+    }
+    return head;
+}
+
+/* left + right, the lists of the elements of list literals are given up */
+static val_t add(val_t left, struct list *left_lst, val_t right, struct list *right_lst) {
+    val_t v = zero;
+
+    if (left.type == 1 && right.type == 1) {
+        v = num(left.data.number + right.data.number);
+    } else if (left.type == 2 && right.type == 2) { // Strings (concatenation)
+        v = (val_t){.type = 2, .data.string = add_strings(left.data.string, right.data.string)};
+        left = right = zero;
+    } else if (left.type == 3 && right.type == 3) {
+        v = (val_t){.type = 3, .data.list = concat_lists(left.data.list, right.data.list)};
+    } else if (left.type == 3) { // Add element to list
+        if (!right_lst) right_lst = list_of_value(right);
+        v = (val_t){.type = 3, .data.list = concat_lists(left.data.list, right_lst)};
+    } else if (right.type == 3) {
+        if (!left_lst) left_lst = list_of_value(left);
+        v = (val_t){.type = 3, .data.list = concat_lists(left_lst, right.data.list)};
+    } else {
+        yyerror("Type mismatch in '+' operation");
+    }
+    list_release(left_lst);
+    list_release(right_lst);
+    drop_value(left);
+    drop_value(right);
+    return v;
+}
+
+static val_t arith(int op, val_t left, val_t right) {
+    if (left.type != right.type) {
+        yyerror("Type mismatch operation");
+        drop_value(left);
+        drop_value(right);
+        return zero;
+    }
+    if (left.type == 2) {
+        yyerror("Invalid operands to arithmetic operator: both must be numbers");
+        exit(1);
+    }
+    drop_value(left); /* lists */
+    drop_value(right);
+    switch (op) {
+        case OP_SUB: return num(left.data.number - right.data.number);
+        case OP_MUL: return num(left.data.number * right.data.number);
+        case OP_DIV: return num(left.data.number / right.data.number);
+        case OP_MOD: return num(fmod(left.data.number, right.data.number));
+        default:     return num(pow(left.data.number, right.data.number));
+    }
+}
+
+static int test(int cmp, val_t left, val_t right) {
+    double l = left.data.number, r = right.data.number;
+
+    switch (cmp) {
+        case '1': return l > r;
+        case '2': return l < r;
+        case '3': return l != r;
+        case '4':
+            if (left.type == 2) {
+                return string_equal(left.data.string, right.data.string);
+            }
+            return l == r;
+        case '5': return l >= r;
+        case '6': return l <= r;
+        case 'O': return l || r;
+        default:  return l && r;
+    }
+}
+
+static val_t compare(int cmp, val_t left, val_t right) {
+    val_t v = zero;
+
+    if (left.type != right.type) {
+        yyerror("Type mismatch for comparison");
+    } else {
+        v = num(test(cmp, left, right));
+    }
+    drop_value(left);
+    drop_value(right);
+    return v;
+}
+
+static val_t get_element(val_t lst, val_t index) {
+    if (lst.type != 3) {
+        yyerror("get() expects a list and an index");
+        return zero;
+    }
+    if (index.type != 1 && index.type != 6 && index.type != 7) {
+        yyerror("get() expects a numeric index");
+        return zero;
+    }
+    val_t *element = get(lst.data.list, index.data.number);
+    if (!element) {
+        yyerror("Index out of bounds");
+        return zero;
+    }
+    return element_of_value(*element); /* also kept by the list */
+}
+
+/* bind the evaluated arguments to the parameters, in a fresh scope */
+static void bind_args(struct symbol *fn, val_t *args) {
+    struct symlist *sl;
+
+    push_scope(fn->nslots);
+    for (sl = fn->syms; sl; sl = sl->next, args++) {
+        struct symbol *x = declare_at(sl->slot, sl->sym->name);
+        if (args->type == 2) { // String
+            x->string = args->data.string; // The argument was pushed for it
+            x->type = 2;
+        } else if (args->type == 3) { // List
+            x->list = args->data.list;
+            x->type = 3;
+        } else
+            x->type = 1;
+        x->value = args->data.number;
+    }
+}
+
+/* run bc on the frames and the stack above the ones in use: a top level
+   unit when fn is NULL, else the code of fn called with args, whose value
+   is returned */
+static val_t run(struct bytecode *bc, struct symbol *fn, val_t *args) {
+    if (!ctx->stack) grow_stack(ctx->stack);
+    if (!ctx->frames) grow_frames(ctx->frames);
+
+    size_t first = ctx->frames_used;   /* frame of bc */
+    struct frame *fp = ctx->frames + first;
+    struct instr *ip = bc->code;
+    val_t *sp = ctx->stack + ctx->stack_used;
+    val_t l, r;
+
+    if (fp == ctx->frames_end) fp = grow_frames(fp);
+    fp->bc = bc;
+    fp->ip = NULL;
+    fp->base = sp - ctx->stack;
+    fp->last = zero;
+    if (fn) {
+        bind_args(fn, args);
+        fp->scope_base = ctx->scope_top - 1;
+    } else {
+        fp->scope_base = ctx->scope_top;
+    }
+
+    for (;;) {
+        struct instr *i = ip++;
+        switch (i->op) {
+            case OP_NUM:
+                PUSH(num(i->k.number));
+                break;
+            case OP_STR:
+                string_retain(i->k.s);
+                PUSH(((val_t){.type = 2, .data.string = i->k.s}));
+                break;
+            case OP_NULL:
+                yyerror("internal error, null eval");
+                PUSH(zero);
+                break;
+            case OP_LOAD:
+                PUSH(load(i));
+                break;
+            case OP_STORE:
+                r = POP();
+                if (i->arg) {
+                    l = POP();
+                    PUSH(store(i, r, l.data.list));
+                } else {
+                    PUSH(store(i, r, NULL));
+                }
+                break;
+            case OP_STORE_INIT:
+                PUSH(store_init(i));
+                break;
+            case OP_DECLARE:
+                declare_symbol(i->slot, i->k.sym); // Copy the symbol
+                break;
+            case OP_ADD:
+                if (i->arg == 0 && sp[-1].type == 1 && sp[-2].type == 1) {
+                    sp[-2].data.number += sp[-1].data.number;
+                    sp--;
+                    break;
+                } else {
+                    struct list *left_lst = NULL, *right_lst = NULL;
+                    r = POP();
+                    if (i->arg & 2) right_lst = POP().data.list;
+                    l = POP();
+                    if (i->arg & 1) left_lst = POP().data.list;
+                    PUSH(add(l, left_lst, r, right_lst));
+                }
+                break;
+            case OP_STORE_ADD: {
+                struct list *left_lst = NULL, *right_lst = NULL;
+                int front = i->arg & 4;
+                r = POP();
+                if (i->arg & 2) right_lst = POP().data.list;
+                l = POP();
+                if (i->arg & 1) left_lst = POP().data.list;
+                if ((front ? r : l).type == 3) {
+                    /* see assign_add() in the tree walker */
+                    struct symbol *sym = slot_at(i->depth, i->slot);
+                    if (sym && list_add_in_place(sym, (front ? r : l).data.list,
+                                                 front ? l : r, front ? left_lst : right_lst, front)) {
+                        drop_value(l);
+                        drop_value(r);
+                        list_release(left_lst);
+                        list_release(right_lst);
+                        PUSH(zero);
+                        break;
+                    }
+                } else if (l.type == 2 && r.type == 2 && !front) {
+                    if (string_add_in_place(var(i), l.data.string, r.data.string)) {
+                        drop_value(r);
+                        PUSH(zero);
+                        break;
+                    }
+                }
+                PUSH(store(i, add(l, left_lst, r, right_lst), NULL));
+                break;
+            }
+            case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW: case OP_MOD:
+                r = POP();
+                l = POP();
+                if (l.type == 1 && r.type == 1 && i->op == OP_SUB) {
+                    PUSH(num(l.data.number - r.data.number));
+                } else {
+                    PUSH(arith(i->op, l, r));
+                }
+                break;
+            case OP_ABS:
+            case OP_NEG:
+                if (sp[-1].type == 2) {
+                    yyerror("Invalid operand to arithmetic operator: must be a number");
+                    exit(1);
+                }
+                drop_value(sp[-1]);
+                sp[-1].type = 1;
+                sp[-1].data.number = i->op == OP_ABS ? fabs(sp[-1].data.number) : -sp[-1].data.number;
+                break;
+            case OP_NOT:
+                l = sp[-1];
+                sp[-1] = num(!l.data.number);
+                drop_value(l);
+                break;
+            case OP_CMP:
+                r = POP();
+                l = POP();
+                PUSH(compare(i->arg, l, r));
+                break;
+            case OP_CHAIN:
+                sp -= i->arg;
+                chain(sp, i->arg);
+                drop_values(sp + 1, i->arg - 1);
+                sp++;
+                break;
+            case OP_LISTLIT:
+                sp -= i->arg;
+                chain(sp, i->arg);
+                l = sp[0];
+                sp[0] = (val_t){.type = 3, .data.list = chain_list(sp, i->arg)};
+                drop_values(sp + 1, i->arg - 1);
+                sp++;
+                PUSH(l);
+                break;
+            case OP_JMP:
+                ip = bc->code + i->arg;
+                break;
+            case OP_JZ:
+                l = POP();
+                drop_value(l);
+                if (l.data.number == 0) ip = bc->code + i->arg;
+                break;
+            case OP_JNZ:
+                l = POP();
+                drop_value(l);
+                if (l.data.number != 0) ip = bc->code + i->arg;
+                break;
+            case OP_POP:
+                drop_value(POP());
+                break;
+            case OP_SETLAST:
+                drop_value(fp->last);
+                fp->last = POP();
+                break;
+            case OP_PUSHLAST:
+                PUSH(element_of_value(fp->last));
+                break;
+            case OP_SCOPE:
+                push_scope(i->arg);
+                break;
+            case OP_UNSCOPE:
+                pop_scope();
+                break;
+            case OP_CALL:
+            case OP_TAILCALL: {
+                struct symbol *callee_fn = var(i), callee;
+                struct symlist *sl;
+                int nargs;
+
+                if (!callee_fn->func) {
+                    yyerror("Call to undefined function: %s", callee_fn->name);
+                    sp -= i->arg;
+                    drop_values(sp, i->arg);
+                    PUSH(zero);
+                    break;
+                }
+                for (nargs = 0, sl = callee_fn->syms; sl; sl = sl->next)
+                    nargs++;
+                if (i->arg < nargs) {
+                    yyerror("Too few args in call to %s", callee_fn->name);
+                    sp -= i->arg;
+                    drop_values(sp, i->arg);
+                    PUSH(zero);
+                    break;
+                }
+                if (!callee_fn->code) callee_fn->code = compile_function(callee_fn);
+
+                sp -= i->arg;
+                drop_values(sp + nargs, i->arg - nargs); /* not bound to a parameter */
+                if (i->op == OP_TAILCALL && (fn || fp != ctx->frames + first) &&
+                    !scopes_seen_by_name(fp->scope_base + 1)) {
+                    /* the callee takes the place of the current frame */
+                    callee = *callee_fn;
+                    callee_fn = &callee;
+                    drop_value(fp->last);
+                    while (ctx->scope_top > fp->scope_base) pop_scope();
+                    memmove(ctx->stack + fp->base, sp, i->arg * sizeof(val_t));
+                    sp = ctx->stack + fp->base;
+                    bind_args(callee_fn, sp);
+                } else {
+                    bind_args(callee_fn, sp);
+                    fp->ip = ip;
+                    if (++fp == ctx->frames_end) fp = grow_frames(fp);
+                    fp->base = sp - ctx->stack;
+                    fp->scope_base = ctx->scope_top - 1;
+                }
+                fp->bc = callee_fn->code;
+                fp->last = zero;
+                bc = callee_fn->code;
+                ip = bc->code;
+                break;
+            }
+            case OP_BUILTIN:
+                l = sp[-1];
+                sp[-1] = apply_builtin(i->arg, l);
+                drop_value(l);
+                break;
+            case OP_GET:
+                l = POP();
+                r = POP();
+                if (i->arg) {
+                    yyerror("get() expects a list and an index");
+                    PUSH(zero);
+                } else {
+                    PUSH(get_element(l, r));
+                }
+                drop_value(l);
+                drop_value(r);
+                break;
+            case OP_PRINT:
+                l = POP();
+                print_value(l);
+                drop_value(l);
+                if (i->arg) printf(" ");
+                break;
+            case OP_RET:
+            case OP_RETLAST:
+                if (i->op == OP_RET) {
+                    r = POP();
+                    drop_value(fp->last);
+                } else {
+                    r = fp->last;
+                }
+                while (ctx->scope_top > fp->scope_base) pop_scope();
+                if (fp == ctx->frames + first) {
+                    if (fn) return r;
+                    ctx->halted = 1; /* give_back outside of a function */
+                    drop_value(r);
+                    return zero;
+                }
+                sp = ctx->stack + fp->base;
+                fp--;
+                bc = fp->bc;
+                ip = fp->ip;
+                PUSH(r);
+                break;
+            case OP_PARFOR:
+                if (parallel_for(i->k.loop, &l)) {
+                    drop_value(fp->last);
+                    fp->last = l;
+                    ip = bc->code + i->arg;
+                }
+                break;
+            case OP_APPLY:
+                r = i->arg == B_reduce ? POP() : zero;
+                l = POP();
+                CALL_OUT(l = apply_function(i->arg, var(i), l, r));
+                PUSH(l);
+                break;
+            case OP_SPAWN:
+                sp -= i->arg;
+                CALL_OUT(l = spawn_task(var(i), sp, i->arg));
+                PUSH(l);
+                break;
+            case OP_AWAIT:
+                l = POP();
+                CALL_OUT(l = await_task(l));
+                PUSH(l);
+                break;
+            case OP_HALT:
+                drop_value(fp->last);
+                return zero;
+        }
+    }
+}
+
+/* run a compiled top level unit */
+void vm_exec(struct bytecode *bc) {
+    if (ctx->halted) return;
+    ctx->stack_used = ctx->frames_used = 0;
+    run(bc, NULL, NULL);
+}
+
+/* call fn with args from a built-in, on the frames above the ones of the
+   vm_exec() running it */
+val_t vm_call(struct symbol *fn, val_t *args) {
+    if (!fn->code) fn->code = compile_function(fn);
+    return run(fn->code, fn, args);
+}
+
+/* run a top level statement list with the selected engine */
+void execute(struct ast *a) {
+    if (ctx->engine == ENGINE_VM) {
+        struct bytecode *bc = compile_unit(a);
+        vm_exec(bc);
+        free_bytecode(bc);
+    } else {
+        drop_value(eval(a));
+    }
+}
+
+/* the stacks of the context */
+void vm_free() {
+    free(ctx->stack);
+    free(ctx->frames);
+    ctx->stack = ctx->stack_end = NULL;
+    ctx->frames = ctx->frames_end = NULL;
+}